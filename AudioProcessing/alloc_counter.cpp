@@ -0,0 +1,44 @@
+#include "alloc_counter.hpp"
+
+#ifdef TDOA_COUNT_ALLOCS
+
+#include <cstdlib>
+#include <new>
+
+static thread_local uint64_t t_heap_allocations = 0;
+
+void* operator new(std::size_t size) {
+    ++t_heap_allocations;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    ++t_heap_allocations;
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept {
+    return ::operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+bool heap_allocation_counting_enabled() { return true; }
+uint64_t thread_heap_allocations() { return t_heap_allocations; }
+
+#else
+
+bool heap_allocation_counting_enabled() { return false; }
+uint64_t thread_heap_allocations() { return 0; }
+
+#endif
@@ -0,0 +1,19 @@
+// =================================================================================================
+// Heap allocation counter (debug aid)
+// =================================================================================================
+//
+// Build with -DTDOA_COUNT_ALLOCS to replace the global operator new/delete with versions that
+// count allocations per thread. The processing loop samples the counter around each hop to prove
+// that steady-state processing never touches the heap. Without the define, nothing is replaced
+// and the counter always reads 0.
+// =================================================================================================
+
+#pragma once
+
+#include <cstdint>
+
+// True when the binary was built with -DTDOA_COUNT_ALLOCS.
+bool heap_allocation_counting_enabled();
+
+// Number of operator new calls made so far by the calling thread.
+uint64_t thread_heap_allocations();
@@ -0,0 +1,242 @@
+#include "array_sim.hpp"
+#include "uma8_geometry.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+// --- Fractional delay filter ---
+const int DELAY_TAPS = 32; // Windowed-sinc length; flat to well past the 3.4 kHz voice band
+
+// --- Speech-like bursts ---
+const double SPEECH_SLOT_S = 1.0;    // At most one burst per slot
+const double SPEECH_RAMP_S = 0.025;  // Raised-cosine attack/release
+const double SPEECH_SYLLABLE_HZ = 4.5;
+const double SPEECH_MAX_FREQ = 3400.0;
+
+// --- Counter-based random numbers (random access by sample index) ---
+static inline uint64_t mix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+static inline double hash_uniform(uint64_t seed, uint64_t stream, uint64_t index) {
+    uint64_t h = mix64(seed ^ mix64(stream ^ mix64(index)));
+    return ((h >> 11) + 0.5) * (1.0 / 9007199254740992.0); // (0, 1)
+}
+
+static inline double hash_gaussian(uint64_t seed, uint64_t stream, uint64_t index) {
+    double u1 = hash_uniform(seed, stream, 2 * index);
+    double u2 = hash_uniform(seed, stream, 2 * index + 1);
+    return std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * M_PI * u2);
+}
+
+// Parameters of the speech-like burst in one slot, derived from the slot index
+struct SpeechBurst {
+    double start_s, end_s;
+    double pitch_hz;
+    double formant1_hz, formant2_hz;
+};
+
+static SpeechBurst speech_burst(const SourceSpec& spec, int64_t slot) {
+    SpeechBurst b;
+    b.start_s = slot * SPEECH_SLOT_S + 0.05 + 0.25 * hash_uniform(spec.seed, 1, slot);
+    b.end_s = b.start_s + 0.25 + 0.45 * hash_uniform(spec.seed, 2, slot);
+    b.pitch_hz = 100.0 + 120.0 * hash_uniform(spec.seed, 3, slot);
+    b.formant1_hz = 400.0 + 400.0 * hash_uniform(spec.seed, 4, slot);
+    b.formant2_hz = 1200.0 + 1200.0 * hash_uniform(spec.seed, 5, slot);
+    return b;
+}
+
+static double harmonic_weight(const SpeechBurst& b, int h) {
+    double f = h * b.pitch_hz;
+    double d1 = (f - b.formant1_hz) / 150.0;
+    double d2 = (f - b.formant2_hz) / 250.0;
+    return (1.0 + 3.0 * std::exp(-d1 * d1) + 2.0 * std::exp(-d2 * d2)) / h;
+}
+
+static float speech_sample(const SourceSpec& spec, int64_t n) {
+    const double t = (double)n / SAMPLE_RATE;
+    const int64_t slot = (int64_t)std::floor(t / SPEECH_SLOT_S);
+    const SpeechBurst b = speech_burst(spec, slot);
+    if (t < b.start_s || t >= b.end_s) return 0.0f;
+
+    // Envelope: raised-cosine edges times a syllabic amplitude modulation
+    const double local = t - b.start_s;
+    const double remaining = b.end_s - t;
+    double env = 1.0;
+    if (local < SPEECH_RAMP_S) env *= 0.5 - 0.5 * std::cos(M_PI * local / SPEECH_RAMP_S);
+    if (remaining < SPEECH_RAMP_S) env *= 0.5 - 0.5 * std::cos(M_PI * remaining / SPEECH_RAMP_S);
+    env *= 0.65 - 0.35 * std::cos(2.0 * M_PI * SPEECH_SYLLABLE_HZ * local);
+
+    // Glottal-like harmonic series with a slight vibrato; phase is the integral of the pitch
+    const double vibrato_hz = 5.0, vibrato_depth = 0.02;
+    const double phase = 2.0 * M_PI * b.pitch_hz *
+        (local - vibrato_depth / (2.0 * M_PI * vibrato_hz) * std::cos(2.0 * M_PI * vibrato_hz * local));
+    const int harmonics = (int)(SPEECH_MAX_FREQ / (b.pitch_hz * (1.0 + vibrato_depth)));
+    double sum = 0.0, norm = 0.0;
+    for (int h = 1; h <= harmonics; ++h) {
+        double a = harmonic_weight(b, h);
+        sum += a * std::sin(h * phase + 0.7 * h * h);
+        norm += 0.5 * a * a;
+    }
+    return (float)(spec.level * env * sum / std::sqrt(norm));
+}
+
+float source_sample(const SourceSpec& spec, int64_t n) {
+    const double t = (double)n / SAMPLE_RATE;
+    switch (spec.type) {
+        case SourceType::Noise:
+            return (float)(spec.level * hash_gaussian(spec.seed, 0, (uint64_t)n));
+        case SourceType::Tone:
+            return (float)(spec.level * M_SQRT2 * std::sin(2.0 * M_PI * spec.freq * t));
+        case SourceType::Chirp: {
+            // Linear sweep f0 -> f1, restarting every period
+            double tau = std::fmod(t, (double)spec.period_s);
+            if (tau < 0) tau += spec.period_s;
+            double phase = 2.0 * M_PI * (spec.f0 * tau + (spec.f1 - spec.f0) * tau * tau / (2.0 * spec.period_s));
+            return (float)(spec.level * M_SQRT2 * std::sin(phase));
+        }
+        case SourceType::Speech:
+            return speech_sample(spec, n);
+    }
+    return 0.0f;
+}
+
+double windowed_sinc(double x, int taps) {
+    const double half = taps / 2.0;
+    if (std::fabs(x) >= half) return 0.0;
+    double sinc = x == 0.0 ? 1.0 : std::sin(M_PI * x) / (M_PI * x);
+    double w = 0.42 + 0.5 * std::cos(M_PI * x / half) + 0.08 * std::cos(2.0 * M_PI * x / half);
+    return sinc * w;
+}
+
+void render_array_chunk(const SimConfig& config, int64_t start_frame, size_t frames, float* const* out) {
+    for (int m = 0; m < CHANNEL_COUNT; ++m) std::fill(out[m], out[m] + frames, 0.0f);
+
+    // Largest arrival advance in samples, plus the filter half-length, bounds the dry margin needed
+    const int max_shift = (int)std::ceil(MIC_RADIUS / SPEED_OF_SOUND * SAMPLE_RATE) + 1;
+    const int margin = max_shift + DELAY_TAPS / 2 + 1;
+    std::vector<float> dry(frames + 2 * margin);
+    std::vector<float> taps(DELAY_TAPS);
+
+    for (const SourceSpec& spec : config.sources) {
+        for (size_t i = 0; i < dry.size(); ++i) {
+            dry[i] = source_sample(spec, start_frame - margin + (int64_t)i);
+        }
+
+        const double angle_rad = spec.angle_deg * M_PI / 180.0;
+        for (int m = 0; m < CHANNEL_COUNT; ++m) {
+            // Plane wave: x_m(t) = s(t + tau_m), tau_m = (p_m . u) / c
+            double projection = MIC_POSITIONS[m].first * std::cos(angle_rad) + MIC_POSITIONS[m].second * std::sin(angle_rad);
+            double advance = projection / SPEED_OF_SOUND * SAMPLE_RATE;
+            int whole = (int)std::floor(advance);
+            double frac = advance - whole;
+            for (int k = 0; k < DELAY_TAPS; ++k) {
+                taps[k] = (float)windowed_sinc((k - DELAY_TAPS / 2 + 1) - frac, DELAY_TAPS);
+            }
+
+            // out[n] = sum_k dry[n + whole + k - DELAY_TAPS/2 + 1] * taps[k]
+            const float* base = dry.data() + margin + whole - DELAY_TAPS / 2 + 1;
+            float* dst = out[m];
+            for (size_t n = 0; n < frames; ++n) {
+                float acc = 0.0f;
+                for (int k = 0; k < DELAY_TAPS; ++k) acc += base[n + k] * taps[k];
+                dst[n] += acc;
+            }
+        }
+    }
+
+    add_mic_noise(config, start_frame, frames, out);
+}
+
+void add_mic_noise(const SimConfig& config, int64_t start_frame, size_t frames, float* const* out) {
+    if (config.mic_noise_level <= 0.0f) return;
+    for (int m = 0; m < CHANNEL_COUNT; ++m) {
+        for (size_t n = 0; n < frames; ++n) {
+            out[m][n] += (float)(config.mic_noise_level * hash_gaussian(config.seed, 100 + m, (uint64_t)(start_frame + n)));
+        }
+    }
+}
+
+std::vector<ActiveInterval> source_activity(const SimConfig& config, double duration_s) {
+    std::vector<ActiveInterval> intervals;
+    for (size_t s = 0; s < config.sources.size(); ++s) {
+        const SourceSpec& spec = config.sources[s];
+        if (spec.type != SourceType::Speech) {
+            intervals.push_back({(int)s, spec.angle_deg, 0.0, duration_s});
+            continue;
+        }
+        for (int64_t slot = 0; slot * SPEECH_SLOT_S < duration_s; ++slot) {
+            SpeechBurst b = speech_burst(spec, slot);
+            if (b.start_s >= duration_s) break;
+            intervals.push_back({(int)s, spec.angle_deg, b.start_s, std::min(b.end_s, duration_s)});
+        }
+    }
+    std::sort(intervals.begin(), intervals.end(),
+              [](const ActiveInterval& a, const ActiveInterval& b) { return a.start_s < b.start_s; });
+    return intervals;
+}
+
+const char* source_type_name(SourceType type) {
+    switch (type) {
+        case SourceType::Noise: return "noise";
+        case SourceType::Tone: return "tone";
+        case SourceType::Chirp: return "chirp";
+        case SourceType::Speech: return "speech";
+    }
+    return "unknown";
+}
+
+bool parse_source_spec(const std::string& text, SourceSpec& spec, std::string& error) {
+    spec = SourceSpec();
+    std::stringstream ss(text);
+    std::string type, angle, params;
+    std::getline(ss, type, ':');
+    std::getline(ss, angle, ':');
+    std::getline(ss, params);
+
+    if (type == "noise") spec.type = SourceType::Noise;
+    else if (type == "tone") spec.type = SourceType::Tone;
+    else if (type == "chirp") spec.type = SourceType::Chirp;
+    else if (type == "speech") spec.type = SourceType::Speech;
+    else {
+        error = "unknown source type '" + type + "' in '" + text + "'";
+        return false;
+    }
+
+    char* end = nullptr;
+    spec.angle_deg = std::strtof(angle.c_str(), &end);
+    if (angle.empty() || *end != '\0') {
+        error = "bad angle in '" + text + "'";
+        return false;
+    }
+
+    std::stringstream ps(params);
+    std::string item;
+    while (std::getline(ps, item, ',')) {
+        size_t eq = item.find('=');
+        if (eq == std::string::npos) {
+            error = "expected key=value, got '" + item + "'";
+            return false;
+        }
+        std::string key = item.substr(0, eq);
+        float value = std::strtof(item.c_str() + eq + 1, &end);
+        if (*end != '\0') {
+            error = "bad value in '" + item + "'";
+            return false;
+        }
+        if (key == "level") spec.level = value;
+        else if (key == "freq") spec.freq = value;
+        else if (key == "f0") spec.f0 = value;
+        else if (key == "f1") spec.f1 = value;
+        else if (key == "period" && value > 0) spec.period_s = value;
+        else {
+            error = "unknown parameter '" + key + "'";
+            return false;
+        }
+    }
+    return true;
+}
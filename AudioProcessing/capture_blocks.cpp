@@ -0,0 +1,59 @@
+#include "capture_blocks.hpp"
+#include "planar_ring.hpp" // deinterleave_f32, deinterleave_s16, PLANAR_MAX_CHANNELS
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+static inline void deinterleave(const float* in, float* const* out, int channels, size_t frames) {
+    deinterleave_f32(in, out, channels, frames);
+}
+
+static inline void deinterleave(const int16_t* in, int16_t* const* out, int channels, size_t frames) {
+    deinterleave_s16(in, out, channels, frames);
+}
+
+template <typename Sample>
+CaptureBlockRing<Sample>::CaptureBlockRing(int channels, size_t block_frames, size_t block_count, int sample_rate)
+    : channels_(channels),
+      block_frames_(block_frames),
+      block_count_(block_count),
+      sample_rate_(sample_rate),
+      data_(block_frames * block_count * channels),
+      times_(block_count, 0),
+      dropped_before_(block_count, 0) {
+    if (channels < 1 || channels > PLANAR_MAX_CHANNELS) {
+        throw std::invalid_argument("CaptureBlockRing holds 1 to " + std::to_string(PLANAR_MAX_CHANNELS) + " channels");
+    }
+}
+
+template <typename Sample>
+size_t CaptureBlockRing<Sample>::write_interleaved(const Sample* in, size_t frames, int64_t time_unix_ns) {
+    const uint64_t written = written_.load(std::memory_order_relaxed);
+    Sample* dst[PLANAR_MAX_CHANNELS];
+    size_t done = 0;
+    while (done < frames) {
+        const uint64_t block = (written + done) / block_frames_;
+        if (block >= released_.load(std::memory_order_acquire) + block_count_) {
+            // Only reachable at offset 0: a block that has been started was free, and stays free
+            dropped_.fetch_add(frames - done, std::memory_order_relaxed);
+            break;
+        }
+        const size_t offset = (written + done) % block_frames_;
+        const size_t n = std::min(frames - done, block_frames_ - offset);
+        if (offset == 0) {
+            const bool timed = time_unix_ns != 0 && sample_rate_ > 0;
+            times_[block % block_count_] = timed ? time_unix_ns + (int64_t)(done * 1e9 / sample_rate_) : 0;
+            dropped_before_[block % block_count_] = dropped_.load(std::memory_order_relaxed);
+        }
+        Sample* slot = data_.data() + (block % block_count_) * channels_ * block_frames_;
+        for (int c = 0; c < channels_; ++c) dst[c] = slot + c * block_frames_ + offset;
+        deinterleave(in + done * channels_, dst, channels_, n);
+        done += n;
+    }
+    written_.store(written + done, std::memory_order_release);
+    return done;
+}
+
+template class CaptureBlockRing<float>;
+template class CaptureBlockRing<int16_t>;
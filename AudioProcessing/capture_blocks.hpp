@@ -0,0 +1,81 @@
+// =================================================================================================
+// Preallocated block storage for recorded multi-channel audio
+// =================================================================================================
+//
+// tdoa_capture's callback stores incoming audio here instead of growing per-channel vectors. All
+// memory is allocated up front as block_count fixed-size blocks of block_frames frames, each block
+// planar (channel c's samples are contiguous). The callback de-interleaves every buffer straight
+// into the current block with the SIMD routines of planar_ring, and never locks or allocates.
+//
+// Blocks are used as a ring. Block b lives in slot b % block_count and can be reused once the
+// consumer has released it; a recorder that keeps everything in memory simply never releases. If
+// the producer catches up with unreleased blocks, the rest of the buffer is dropped and counted
+// rather than waiting. Drops always start at a block boundary, and each block records how many
+// frames were dropped before it, so the consumer can put the gap back (as silence) and keep frame
+// indices on the capture timeline.
+//
+// Each block also records the system clock time its first frame was captured, derived from the
+// time the producer passes with each buffer.
+//
+// Single producer, single consumer. The producer publishes with a release store of the total frame
+// count; the consumer acquires it with frames_written() before reading a block.
+// =================================================================================================
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Instantiated for float and int16_t only (capture_blocks.cpp).
+template <typename Sample>
+class CaptureBlockRing {
+public:
+    // Throws std::invalid_argument unless 1 <= channels <= PLANAR_MAX_CHANNELS (planar_ring.hpp)
+    CaptureBlockRing(int channels, size_t block_frames, size_t block_count, int sample_rate = 0);
+
+    // Producer side: de-interleaves and appends `frames` interleaved frames. Returns the number
+    // stored; the rest were dropped because every block was still waiting for the consumer.
+    // time_unix_ns is when in[0] was captured (0 if unknown); blocks starting later in the buffer
+    // are timed from it at the sample rate.
+    size_t write_interleaved(const Sample* in, size_t frames, int64_t time_unix_ns = 0);
+
+    // Total number of frames ever stored (monotonic). Block b is complete once this reaches
+    // (b + 1) * block_frames().
+    uint64_t frames_written() const { return written_.load(std::memory_order_acquire); }
+    uint64_t dropped_frames() const { return dropped_.load(std::memory_order_relaxed); }
+
+    // Consumer side: channel ch of block b (block_frames() contiguous samples)
+    const Sample* block_channel(uint64_t block, int ch) const {
+        return data_.data() + ((block % block_count_) * channels_ + ch) * block_frames_;
+    }
+    // Consumer side: system clock time of block b's first frame, 0 if unknown
+    int64_t block_time_ns(uint64_t block) const { return times_[block % block_count_]; }
+    // Consumer side: frames dropped before block b, which therefore starts at capture frame
+    // b * block_frames() + block_dropped_before(b)
+    uint64_t block_dropped_before(uint64_t block) const { return dropped_before_[block % block_count_]; }
+
+    // Consumer side: blocks before `block` may be overwritten from now on
+    void release_until(uint64_t block) { released_.store(block, std::memory_order_release); }
+
+    int channels() const { return channels_; }
+    size_t block_frames() const { return block_frames_; }
+    size_t block_count() const { return block_count_; }
+
+    // The whole storage, e.g. for prefaulting
+    Sample* storage() { return data_.data(); }
+    size_t storage_samples() const { return data_.size(); }
+
+private:
+    int channels_;
+    size_t block_frames_;
+    size_t block_count_;
+    int sample_rate_;
+    std::vector<Sample> data_; // [slot][channel][frame]
+    std::vector<int64_t> times_; // [slot], published with the samples
+    std::vector<uint64_t> dropped_before_; // [slot], published with the samples
+    std::atomic<uint64_t> written_{0};
+    std::atomic<uint64_t> released_{0}; // Blocks the consumer is done with
+    std::atomic<uint64_t> dropped_{0};
+};
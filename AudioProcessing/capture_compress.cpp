@@ -0,0 +1,575 @@
+#include "capture_compress.hpp"
+#include "planar_ring.hpp" // convert_s16_to_f32, convert_f32_to_s16
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+const size_t WRITE_BATCH_BYTES = 1 << 20; // Encoded output collected before each write
+const int MAX_PREDICTOR_ORDER = 4;
+const uint32_t RICE_ESCAPE = 31;          // Rice parameter marking a partition of fixed-width values
+const int QUANTIZATION_SHIFTS[] = {15, 23}; // Float samples that are int16 or int24 values
+
+// --- Bit I/O (most significant bit first) ---
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : out_(out) {}
+
+    // Appends the low `bits` bits of value (bits <= 32)
+    void put(uint32_t value, int bits) {
+        acc_ = (acc_ << bits) | (value & (uint32_t)((1ull << bits) - 1));
+        count_ += bits;
+        while (count_ >= 8) {
+            count_ -= 8;
+            out_.push_back((uint8_t)(acc_ >> count_));
+        }
+    }
+
+    // q zeros and a one
+    void put_unary(uint32_t q) {
+        for (; q >= 32; q -= 32) put(0, 32);
+        put(1, (int)q + 1);
+    }
+
+    void align() {
+        if (count_ > 0) put(0, 8 - count_);
+    }
+
+private:
+    std::vector<uint8_t>& out_;
+    uint64_t acc_ = 0;
+    int count_ = 0; // Bits in acc_ not yet flushed to out_ (always < 8 between calls)
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t bytes) : p_(data), end_(data + bytes) {}
+
+    uint32_t get(int bits) {
+        if (bits == 0) return 0;
+        refill();
+        const uint32_t value = (uint32_t)(acc_ >> (64 - bits));
+        acc_ <<= bits;
+        count_ -= bits;
+        return value;
+    }
+
+    uint32_t get_unary() {
+        uint32_t q = 0;
+        while (!damaged()) {
+            refill();
+            if (acc_ == 0) {
+                q += count_; // Every buffered bit is a zero
+                count_ = 0;
+                continue;
+            }
+            const int zeros = count_leading_zeros(acc_);
+            q += zeros;
+            acc_ <<= zeros + 1;
+            count_ -= zeros + 1;
+            return q;
+        }
+        return 0;
+    }
+
+    // True once reads have gone past the end of the data
+    bool damaged() const { return padding_ > 8; }
+
+private:
+    static int count_leading_zeros(uint64_t value) {
+        #if defined(__GNUC__) || defined(__clang__)
+            return __builtin_clzll(value);
+        #else
+            int zeros = 0;
+            while (!(value & (1ull << 63))) {
+                value <<= 1;
+                ++zeros;
+            }
+            return zeros;
+        #endif
+    }
+
+    // Tops acc_ up to at least 57 bits; acc_ is left aligned
+    void refill() {
+        while (count_ <= 56) {
+            uint64_t byte = 0;
+            if (p_ < end_) {
+                byte = *p_++;
+            } else {
+                ++padding_;
+            }
+            acc_ |= byte << (56 - count_);
+            count_ += 8;
+        }
+    }
+
+    const uint8_t* p_;
+    const uint8_t* end_;
+    uint64_t acc_ = 0;
+    int count_ = 0;
+    int padding_ = 0; // Zero bytes supplied past the end
+};
+
+// --- Prediction ---
+static inline uint32_t zigzag(int32_t value) { return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31); }
+static inline int32_t unzigzag(uint32_t value) { return (int32_t)(value >> 1) ^ -(int32_t)(value & 1); }
+
+// Fixed polynomial prediction of x[i] from the `order` samples before it. Captured samples are at
+// most 24 bits, so this never overflows while encoding; the decoder wraps (unsigned) on damaged data.
+static inline uint32_t predict(const int32_t* x, size_t i, int order) {
+    switch (order) {
+        case 0: return 0;
+        case 1: return (uint32_t)x[i - 1];
+        case 2: return 2u * x[i - 1] - x[i - 2];
+        case 3: return 3u * x[i - 1] - 3u * x[i - 2] + x[i - 3];
+        default: return 4u * x[i - 1] - 6u * x[i - 2] + 4u * x[i - 3] - x[i - 4];
+    }
+}
+
+// Sum of |residual| for every predictor order at once, over the samples all orders predict.
+// Residuals of successive orders are successive differences, so one branch-free pass does it.
+static void predictor_costs(const int32_t* x, size_t n, uint64_t cost[MAX_PREDICTOR_ORDER + 1]) {
+    uint64_t c0 = 0, c1 = 0, c2 = 0, c3 = 0, c4 = 0;
+    for (size_t i = MAX_PREDICTOR_ORDER; i < n; ++i) {
+        const int32_t e0 = x[i];
+        const int32_t e1 = e0 - x[i - 1];
+        const int32_t e2 = e1 - (x[i - 1] - x[i - 2]);
+        const int32_t e3 = e2 - (x[i - 1] - 2 * x[i - 2] + x[i - 3]);
+        const int32_t e4 = e3 - (x[i - 1] - 3 * x[i - 2] + 3 * x[i - 3] - x[i - 4]);
+        c0 += (uint32_t)std::abs(e0);
+        c1 += (uint32_t)std::abs(e1);
+        c2 += (uint32_t)std::abs(e2);
+        c3 += (uint32_t)std::abs(e3);
+        c4 += (uint32_t)std::abs(e4);
+    }
+    cost[0] = c0;
+    cost[1] = c1;
+    cost[2] = c2;
+    cost[3] = c3;
+    cost[4] = c4;
+}
+
+static int best_order(const int32_t* x, size_t n, uint64_t& best_cost) {
+    uint64_t cost[MAX_PREDICTOR_ORDER + 1];
+    predictor_costs(x, n, cost);
+    int order = 0;
+    for (int o = 1; o <= MAX_PREDICTOR_ORDER; ++o) {
+        if (cost[o] < cost[order]) order = o;
+    }
+    best_cost = cost[order];
+    return order;
+}
+
+// Zigzagged residual of x under the given order; samples i < order use order i
+static void compute_residual(const int32_t* x, size_t n, int order, uint32_t* out) {
+    const size_t warmup = std::min<size_t>(order, n);
+    for (size_t i = 0; i < warmup; ++i) out[i] = zigzag(x[i] - (int32_t)predict(x, i, (int)i));
+    // One loop per order, so each is a plain vectorizable difference
+    switch (order) {
+        case 0:
+            for (size_t i = warmup; i < n; ++i) out[i] = zigzag(x[i]);
+            break;
+        case 1:
+            for (size_t i = warmup; i < n; ++i) out[i] = zigzag(x[i] - x[i - 1]);
+            break;
+        case 2:
+            for (size_t i = warmup; i < n; ++i) out[i] = zigzag(x[i] - 2 * x[i - 1] + x[i - 2]);
+            break;
+        case 3:
+            for (size_t i = warmup; i < n; ++i) out[i] = zigzag(x[i] - 3 * x[i - 1] + 3 * x[i - 2] - x[i - 3]);
+            break;
+        default:
+            for (size_t i = warmup; i < n; ++i) out[i] = zigzag(x[i] - 4 * x[i - 1] + 6 * x[i - 2] - 4 * x[i - 3] + x[i - 4]);
+            break;
+    }
+}
+
+static size_t partition_frames(size_t n) { return (n + COMPRESSED_RICE_PARTITIONS - 1) / COMPRESSED_RICE_PARTITIONS; }
+
+static int bit_width(uint32_t value) {
+    int width = 0;
+    while (value != 0) {
+        ++width;
+        value >>= 1;
+    }
+    return width;
+}
+
+// Rice codes each partition with the parameter that is exactly cheapest around the mean's log2,
+// or stores it as fixed-width values when that is cheaper (outliers, noise)
+static void write_residual(const uint32_t* u, size_t n, BitWriter& bits) {
+    const size_t part = partition_frames(n);
+    for (size_t start = 0; start < n; start += part) {
+        const size_t length = std::min(part, n - start);
+        const uint32_t* values = u + start;
+        uint64_t sum = 0;
+        uint32_t largest = 0;
+        for (size_t i = 0; i < length; ++i) {
+            sum += values[i];
+            largest = std::max(largest, values[i]);
+        }
+
+        const uint64_t mean = sum / length;
+        const int guess = mean > 0 ? bit_width((uint32_t)std::min<uint64_t>(mean, UINT32_MAX)) - 1 : 0;
+        int best_k = -1;
+        uint64_t best_bits = 0;
+        for (int k = std::max(0, guess - 1); k <= std::min(30, guess + 1); ++k) {
+            uint64_t cost = (uint64_t)length * (k + 1);
+            for (size_t i = 0; i < length; ++i) cost += values[i] >> k;
+            if (best_k < 0 || cost < best_bits) {
+                best_k = k;
+                best_bits = cost;
+            }
+        }
+
+        const int width = bit_width(largest);
+        if (6 + (uint64_t)length * width < best_bits) {
+            bits.put(RICE_ESCAPE, 5);
+            bits.put((uint32_t)width, 6);
+            for (size_t i = 0; i < length; ++i) bits.put(values[i], width);
+            continue;
+        }
+        bits.put((uint32_t)best_k, 5);
+        for (size_t i = 0; i < length; ++i) {
+            bits.put_unary(values[i] >> best_k);
+            bits.put(values[i], best_k);
+        }
+    }
+}
+
+// Float samples as integers scaled by 2^shift, if every one converts exactly (-0.0 does not)
+static bool quantize(const float* in, size_t count, int shift, int32_t* out) {
+    const float scale = std::ldexp(1.0f, shift);
+    bool exact = true;
+    for (size_t i = 0; i < count; ++i) {
+        const float scaled = in[i] * scale;
+        const bool in_range = std::fabs(scaled) <= 16777216.0f; // Also false for NaN
+        const int32_t value = in_range ? (int32_t)scaled : 0;
+        exact &= in_range && (float)value == scaled && !(value == 0 && std::signbit(in[i]));
+        out[i] = value;
+    }
+    return exact;
+}
+
+bool is_compressed_capture(const std::string& path) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) return false;
+    char magic[sizeof(COMPRESSED_CAPTURE_MAGIC)] = {};
+    const bool match = std::fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+                       std::memcmp(magic, COMPRESSED_CAPTURE_MAGIC, sizeof(magic)) == 0;
+    std::fclose(file);
+    return match;
+}
+
+// --- Writer ---
+CompressedCaptureWriter::~CompressedCaptureWriter() {
+    std::string ignored;
+    close(ignored);
+}
+
+bool CompressedCaptureWriter::open(const std::string& path, const CaptureStreamInfo& info, std::string& error) {
+    if (info.channels < 1 || info.channels > COMPRESSED_MAX_CHANNELS) {
+        error = "the compressed capture format holds 1 to " + std::to_string(COMPRESSED_MAX_CHANNELS) + " channels";
+        return false;
+    }
+    file_ = std::fopen(path.c_str(), "wb");
+    if (file_ == nullptr) {
+        error = "could not open " + path + " for writing";
+        return false;
+    }
+    std::setvbuf(file_, nullptr, _IONBF, 0); // batch_ is the only buffer
+    path_ = path;
+
+    header_ = CompressedCaptureHeader();
+    std::memcpy(header_.magic, COMPRESSED_CAPTURE_MAGIC, sizeof(header_.magic));
+    header_.version = COMPRESSED_CAPTURE_VERSION;
+    header_.sample_rate = info.sample_rate;
+    header_.channels = info.channels;
+    header_.sample_format = info.s16 ? 1 : 0;
+    header_.block_frames = COMPRESSED_BLOCK_FRAMES;
+
+    const size_t block_samples = (size_t)info.channels * COMPRESSED_BLOCK_FRAMES;
+    block_f32_.assign(info.s16 ? 0 : block_samples, 0.0f);
+    block_s16_.assign(info.s16 ? block_samples : 0, 0);
+    ints_.assign(block_samples, 0);
+    scratch_.assign(COMPRESSED_BLOCK_FRAMES, 0);
+    residual_.assign(COMPRESSED_BLOCK_FRAMES, 0);
+    block_fill_ = 0;
+    frames_ = 0;
+    file_bytes_ = 0;
+    raw_bytes_ = 0;
+
+    batch_.clear();
+    batch_.reserve(WRITE_BATCH_BYTES + block_samples * sizeof(float) + 2 * sizeof(CompressedBlockHeader));
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&header_);
+    batch_.insert(batch_.end(), bytes, bytes + sizeof(header_));
+    return true;
+}
+
+bool CompressedCaptureWriter::write(const CaptureChunk& chunk, std::string& error) {
+    const int channels = header_.channels;
+    const bool s16 = header_.sample_format == 1;
+    size_t done = 0;
+    while (done < chunk.frames) {
+        if (block_fill_ == 0) {
+            block_first_frame_ = frames_;
+            block_time_ns_ = chunk.time_unix_ns == 0 ? 0 : chunk.time_unix_ns + (int64_t)(done * 1e9 / header_.sample_rate);
+        }
+        const size_t n = std::min<size_t>(chunk.frames - done, COMPRESSED_BLOCK_FRAMES - block_fill_);
+        for (int c = 0; c < channels; ++c) {
+            const size_t at = (size_t)c * COMPRESSED_BLOCK_FRAMES + block_fill_;
+            if (s16) {
+                if (chunk.s16 != nullptr) {
+                    std::memcpy(&block_s16_[at], chunk.s16[c] + done, n * sizeof(int16_t));
+                } else {
+                    convert_f32_to_s16(chunk.f32[c] + done, &block_s16_[at], n);
+                }
+            } else {
+                if (chunk.f32 != nullptr) {
+                    std::memcpy(&block_f32_[at], chunk.f32[c] + done, n * sizeof(float));
+                } else {
+                    convert_s16_to_f32(chunk.s16[c] + done, &block_f32_[at], n);
+                }
+            }
+        }
+        block_fill_ += (uint32_t)n;
+        frames_ += n;
+        done += n;
+        if (block_fill_ == COMPRESSED_BLOCK_FRAMES && !encode_block(error)) return false;
+    }
+    return true;
+}
+
+bool CompressedCaptureWriter::encode_block(std::string& error) {
+    const int channels = header_.channels;
+    const bool s16 = header_.sample_format == 1;
+    const size_t n = block_fill_;
+    const size_t stride = COMPRESSED_BLOCK_FRAMES;
+    const size_t raw_block_bytes = (size_t)channels * n * (s16 ? sizeof(int16_t) : sizeof(float));
+    raw_bytes_ += raw_block_bytes;
+
+    CompressedBlockHeader block = {};
+    block.frames = (uint32_t)n;
+    block.first_frame = block_first_frame_;
+    block.time_unix_ns = block_time_ns_;
+    block.mode = COMPRESSED_BLOCK_CODED;
+
+    // The block as integers, or verbatim if the floats are not exactly int16 / int24 values
+    bool coded = true;
+    if (s16) {
+        for (int c = 0; c < channels; ++c) {
+            for (size_t i = 0; i < n; ++i) ints_[c * stride + i] = block_s16_[c * stride + i];
+        }
+    } else {
+        coded = false;
+        for (int shift : QUANTIZATION_SHIFTS) {
+            bool exact = true;
+            for (int c = 0; c < channels && exact; ++c) {
+                exact = quantize(&block_f32_[c * stride], n, shift, &ints_[c * stride]);
+            }
+            if (exact) {
+                block.shift = (uint8_t)shift;
+                coded = true;
+                break;
+            }
+        }
+    }
+
+    const size_t header_at = batch_.size();
+    batch_.resize(header_at + sizeof(CompressedBlockHeader));
+    if (coded) {
+        BitWriter bits(batch_);
+        const int32_t* reference = ints_.data();
+        for (int c = 0; c < channels; ++c) {
+            const int32_t* x = &ints_[c * stride];
+            if (std::all_of(x, x + n, [&](int32_t v) { return v == x[0]; })) {
+                bits.put(0, 1);
+                bits.put(0, 1);
+                bits.put((uint32_t)x[0], 32);
+                continue;
+            }
+
+            // Inter-channel decorrelation: code the difference from channel 0 if that is cheaper
+            uint64_t cost = 0;
+            int order = best_order(x, n, cost);
+            const int32_t* signal = x;
+            bool difference = false;
+            if (c > 0) {
+                for (size_t i = 0; i < n; ++i) scratch_[i] = x[i] - reference[i];
+                uint64_t difference_cost = 0;
+                const int difference_order = best_order(scratch_.data(), n, difference_cost);
+                if (difference_cost < cost) {
+                    order = difference_order;
+                    signal = scratch_.data();
+                    difference = true;
+                }
+            }
+            bits.put(1, 1);
+            bits.put(difference ? 1 : 0, 1);
+            bits.put((uint32_t)order, 3);
+            compute_residual(signal, n, order, residual_.data());
+            write_residual(residual_.data(), n, bits);
+        }
+        bits.align();
+    }
+
+    // Never larger than the samples themselves
+    if (!coded || batch_.size() - header_at - sizeof(CompressedBlockHeader) >= raw_block_bytes) {
+        batch_.resize(header_at + sizeof(CompressedBlockHeader));
+        block.mode = COMPRESSED_BLOCK_VERBATIM;
+        block.shift = 0;
+        for (int c = 0; c < channels; ++c) {
+            const uint8_t* samples = s16 ? reinterpret_cast<const uint8_t*>(&block_s16_[c * stride])
+                                         : reinterpret_cast<const uint8_t*>(&block_f32_[c * stride]);
+            batch_.insert(batch_.end(), samples, samples + n * (s16 ? sizeof(int16_t) : sizeof(float)));
+        }
+    }
+    block.payload_bytes = (uint32_t)(batch_.size() - header_at - sizeof(CompressedBlockHeader));
+    std::memcpy(&batch_[header_at], &block, sizeof(block));
+    block_fill_ = 0;
+    return batch_.size() < WRITE_BATCH_BYTES || flush(error);
+}
+
+bool CompressedCaptureWriter::flush(std::string& error) {
+    if (batch_.empty()) return true;
+    const size_t written = std::fwrite(batch_.data(), 1, batch_.size(), file_);
+    file_bytes_ += written;
+    const bool ok = written == batch_.size();
+    batch_.clear();
+    if (!ok) error = "could not write to " + path_ + " (disk full?)";
+    return ok;
+}
+
+bool CompressedCaptureWriter::close(std::string& error) {
+    if (file_ == nullptr) return true;
+    bool ok = (block_fill_ == 0 || encode_block(error)) && flush(error);
+    if (std::fclose(file_) != 0 && ok) {
+        error = "could not finish writing " + path_;
+        ok = false;
+    }
+    file_ = nullptr;
+    return ok;
+}
+
+// --- Reader ---
+static bool decode_block(const CompressedBlockHeader& block, const uint8_t* payload, int channels,
+                         std::vector<int32_t>& ints) {
+    const size_t n = block.frames;
+    ints.resize((size_t)channels * n);
+    BitReader bits(payload, block.payload_bytes);
+    for (int c = 0; c < channels; ++c) {
+        int32_t* x = &ints[c * n];
+        const bool predicted = bits.get(1) != 0;
+        const bool difference = bits.get(1) != 0;
+        if (!predicted) {
+            std::fill(x, x + n, (int32_t)bits.get(32));
+            continue;
+        }
+        const int order = (int)bits.get(3);
+        if (order > MAX_PREDICTOR_ORDER || (difference && c == 0)) return false;
+
+        // Residuals first, then the prediction is undone in place
+        const size_t part = partition_frames(n);
+        for (size_t start = 0; start < n; start += part) {
+            const size_t length = std::min(part, n - start);
+            const uint32_t k = bits.get(5);
+            if (k == RICE_ESCAPE) {
+                const int width = (int)bits.get(6);
+                if (width > 32) return false;
+                for (size_t i = 0; i < length; ++i) x[start + i] = unzigzag(bits.get(width));
+            } else {
+                for (size_t i = 0; i < length; ++i) {
+                    const uint32_t q = bits.get_unary();
+                    x[start + i] = unzigzag((q << k) | bits.get((int)k));
+                }
+            }
+            if (bits.damaged()) return false;
+        }
+        for (size_t i = 0; i < n; ++i) x[i] = (int32_t)(x[i] + predict(x, i, std::min<int>(order, (int)i)));
+        if (difference) {
+            for (size_t i = 0; i < n; ++i) x[i] = (int32_t)((uint32_t)x[i] + (uint32_t)ints[i]);
+        }
+    }
+    return true;
+}
+
+bool load_capture_compressed(const std::string& path, int channels, int sample_rate, std::vector<float>& interleaved,
+                             std::string& error) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        error = "could not open " + path;
+        return false;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    CompressedCaptureHeader header;
+    if (data.size() < sizeof(header) || std::memcmp(data.data(), COMPRESSED_CAPTURE_MAGIC, sizeof(header.magic)) != 0) {
+        error = path + " is not a compressed capture";
+        return false;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.version != COMPRESSED_CAPTURE_VERSION) {
+        error = path + " was written by an incompatible version (format " + std::to_string(header.version) + ")";
+        return false;
+    }
+    if (header.channels != channels) {
+        error = path + " has " + std::to_string(header.channels) + " channels, expected " + std::to_string(channels);
+        return false;
+    }
+    if (header.sample_rate != sample_rate) {
+        error = path + " was recorded at " + std::to_string(header.sample_rate) + " Hz, expected " +
+                std::to_string(sample_rate) + " Hz";
+        return false;
+    }
+
+    interleaved.clear();
+    std::vector<int32_t> ints;
+    std::vector<float> planar;
+    size_t at = sizeof(header);
+    while (at < data.size()) {
+        CompressedBlockHeader block;
+        if (data.size() - at < sizeof(block)) break; // A block the writer did not finish
+        std::memcpy(&block, &data[at], sizeof(block));
+        at += sizeof(block);
+        if (data.size() - at < block.payload_bytes) break;
+        if (block.frames == 0 || block.frames > header.block_frames) {
+            error = path + " is damaged (block at frame " + std::to_string(block.first_frame) + ")";
+            return false;
+        }
+        const uint8_t* payload = &data[at];
+        at += block.payload_bytes;
+
+        // Planar floats, from integers or verbatim samples
+        const size_t n = block.frames;
+        planar.resize((size_t)channels * n);
+        if (block.mode == COMPRESSED_BLOCK_CODED) {
+            if (!decode_block(block, payload, channels, ints)) {
+                error = path + " is damaged (block at frame " + std::to_string(block.first_frame) + ")";
+                return false;
+            }
+            const float scale = header.sample_format == 1 ? 1.0f / 32768.0f : std::ldexp(1.0f, -(int)block.shift);
+            for (size_t i = 0; i < planar.size(); ++i) planar[i] = ints[i] * scale;
+        } else {
+            const size_t sample_size = header.sample_format == 1 ? sizeof(int16_t) : sizeof(float);
+            if (block.payload_bytes != planar.size() * sample_size) {
+                error = path + " is damaged (block at frame " + std::to_string(block.first_frame) + ")";
+                return false;
+            }
+            if (header.sample_format == 1) {
+                std::vector<int16_t> samples(planar.size());
+                std::memcpy(samples.data(), payload, block.payload_bytes);
+                convert_s16_to_f32(samples.data(), planar.data(), samples.size());
+            } else {
+                std::memcpy(planar.data(), payload, block.payload_bytes);
+            }
+        }
+
+        const size_t base = interleaved.size();
+        interleaved.resize(base + planar.size());
+        for (size_t i = 0; i < n; ++i) {
+            for (int c = 0; c < channels; ++c) interleaved[base + i * channels + c] = planar[c * n + i];
+        }
+    }
+    return true;
+}
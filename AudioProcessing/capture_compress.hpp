@@ -0,0 +1,121 @@
+// =================================================================================================
+// Lossless compressed captures (.u8z)
+// =================================================================================================
+//
+// A FLAC-style codec for the 8-channel capture stream, written by a CaptureSink on the capture
+// program's writer thread or tdoa_realtime's recorder thread (never the audio callback). Microphone
+// audio shrinks about 2x against int16 samples and 4x against float32; silence to almost nothing.
+//
+// The stream is cut into blocks of COMPRESSED_BLOCK_FRAMES frames. Each block is coded on integers:
+//   - int16 captures are used as they are. Float captures from the device are int16 or int24
+//     values scaled by 2^-15 or 2^-23; a block whose samples are all exactly such values is coded
+//     as those integers (the shift is stored). Any other block is stored verbatim, so decoding is
+//     always bit-exact.
+//   - Inter-channel decorrelation: every channel after the first may be coded as its difference
+//     from channel 0 (the mics are 45 mm apart, so they hear much the same signal), whichever is
+//     cheaper.
+//   - Linear prediction: a fixed polynomial predictor of order 0-4 per channel, as FLAC's fixed
+//     subframes (no coefficients to quantize or transmit). The predictors are integer differences
+//     over planar arrays, which the compiler vectorizes.
+//   - Rice coding of the zigzagged residual in COMPRESSED_RICE_PARTITIONS partitions, each with its
+//     own parameter (or raw fixed-width values where that is cheaper). A constant channel costs
+//     one value.
+//
+// Layout: CompressedCaptureHeader, then per block a CompressedBlockHeader followed by
+// payload_bytes of payload. The payload of a coded block is a big-endian bit stream of one
+// subframe per channel:
+//   type (1 bit: 0 constant, 1 predicted), difference from channel 0 (1 bit), then
+//   constant:  the value (32 bits)
+//   predicted: order (3 bits), then per partition a Rice parameter (5 bits) and the residuals,
+//              each as unary(u >> k) followed by the low k bits of u. Parameter 31 marks an
+//              escaped partition: a width (6 bits) and every residual in that many bits.
+// Samples i < order are predicted with order i, so no warm-up samples are stored. A verbatim
+// block's payload is the planar samples as captured.
+// =================================================================================================
+
+#pragma once
+
+#include "capture_writer.hpp" // CaptureSink
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+const char COMPRESSED_CAPTURE_MAGIC[8] = "UMA8CMP";
+const uint32_t COMPRESSED_CAPTURE_VERSION = 1;
+const uint32_t COMPRESSED_BLOCK_FRAMES = 4096;
+const int COMPRESSED_RICE_PARTITIONS = 16;
+const int COMPRESSED_MAX_CHANNELS = 16;
+
+const uint8_t COMPRESSED_BLOCK_CODED = 0;
+const uint8_t COMPRESSED_BLOCK_VERBATIM = 1;
+
+struct CompressedCaptureHeader {
+    char magic[8];                     // COMPRESSED_CAPTURE_MAGIC
+    uint32_t version;
+    int32_t sample_rate;
+    int32_t channels;
+    uint32_t sample_format;            // 0 float32, 1 int16 (as CAPTURE_FILE_F32 / CAPTURE_FILE_S16)
+    uint32_t block_frames;
+    uint32_t reserved;
+};
+
+struct CompressedBlockHeader {
+    uint32_t payload_bytes;
+    uint32_t frames;                   // block_frames except in the last block
+    uint64_t first_frame;
+    int64_t time_unix_ns;              // System clock time the first frame was captured; 0 if unknown
+    uint8_t mode;                      // COMPRESSED_BLOCK_CODED or COMPRESSED_BLOCK_VERBATIM
+    uint8_t shift;                     // Coded float blocks: sample = integer * 2^-shift
+    uint16_t reserved;
+    uint32_t reserved2;
+};
+
+static_assert(sizeof(CompressedCaptureHeader) == 32, "the header layout is part of the file format");
+static_assert(sizeof(CompressedBlockHeader) == 32, "the block header layout is part of the file format");
+
+// True if `path` starts with COMPRESSED_CAPTURE_MAGIC
+bool is_compressed_capture(const std::string& path);
+
+class CompressedCaptureWriter : public CaptureSink {
+public:
+    ~CompressedCaptureWriter() override;
+
+    bool open(const std::string& path, const CaptureStreamInfo& info, std::string& error) override;
+    bool write(const CaptureChunk& chunk, std::string& error) override;
+    bool close(std::string& error) override;
+
+    uint64_t bytes_written() const override { return file_bytes_ + batch_.size(); }
+
+    // Size of the same audio as raw samples, for reporting the compression ratio
+    uint64_t raw_bytes() const { return raw_bytes_; }
+
+private:
+    bool encode_block(std::string& error);
+    bool flush(std::string& error);
+
+    std::FILE* file_ = nullptr;
+    std::string path_;
+    CompressedCaptureHeader header_ = {};
+    std::vector<float> block_f32_;     // The block being assembled, planar in the capture's format
+    std::vector<int16_t> block_s16_;
+    uint32_t block_fill_ = 0;
+    uint64_t block_first_frame_ = 0;
+    int64_t block_time_ns_ = 0;
+    uint64_t frames_ = 0;
+
+    std::vector<int32_t> ints_;        // The block as integers, planar
+    std::vector<int32_t> scratch_;
+    std::vector<uint32_t> residual_;
+    std::vector<uint8_t> batch_;       // Encoded blocks waiting to be written
+    uint64_t file_bytes_ = 0;
+    uint64_t raw_bytes_ = 0;
+};
+
+// Decodes a whole .u8z capture into interleaved float frames (int16 scaled to [-1, 1)), like
+// load_capture_csv. Fails if the file does not have exactly `channels` channels at `sample_rate`,
+// or is damaged.
+bool load_capture_compressed(const std::string& path, int channels, int sample_rate, std::vector<float>& interleaved,
+                             std::string& error);
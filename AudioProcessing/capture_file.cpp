@@ -0,0 +1,418 @@
+#include "capture_file.hpp"
+#include "planar_ring.hpp" // convert_s16_to_f32, convert_f32_to_s16
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(_WIN32)
+    #ifndef NOMINMAX
+        #define NOMINMAX // Keep std::min / std::max usable
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #include <cerrno>
+#endif
+
+static_assert(sizeof(CaptureFileBlockHeader) <= CAPTURE_FILE_BLOCK_HEADER_BYTES, "block header must fit its reserved space");
+static_assert(sizeof(CaptureFileHeader) <= CAPTURE_FILE_HEADER_BYTES, "file header must fit its reserved space");
+
+static size_t sample_bytes(uint32_t sample_format) {
+    return sample_format == CAPTURE_FILE_S16 ? sizeof(int16_t) : sizeof(float);
+}
+
+bool is_capture_file(const std::string& path) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) return false;
+    char magic[sizeof(CAPTURE_FILE_MAGIC)] = {};
+    const bool match = std::fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+                       std::memcmp(magic, CAPTURE_FILE_MAGIC, sizeof(magic)) == 0;
+    std::fclose(file);
+    return match;
+}
+
+// --- Writer ---
+CaptureFileWriter::~CaptureFileWriter() {
+    std::string ignored;
+    close(ignored);
+}
+
+bool CaptureFileWriter::open(const std::string& path, const CaptureStreamInfo& info, std::string& error) {
+    if (info.channels < 1 || info.channels > CAPTURE_FILE_MAX_CHANNELS) {
+        error = "the binary capture format holds 1 to " + std::to_string(CAPTURE_FILE_MAX_CHANNELS) + " channels";
+        return false;
+    }
+    file_ = std::fopen(path.c_str(), "wb");
+    if (file_ == nullptr) {
+        error = "could not open " + path + " for writing";
+        return false;
+    }
+    std::setvbuf(file_, nullptr, _IONBF, 0); // Blocks are written whole; there is nothing to buffer
+    path_ = path;
+
+    header_ = CaptureFileHeader();
+    std::memcpy(header_.magic, CAPTURE_FILE_MAGIC, sizeof(header_.magic));
+    header_.version = CAPTURE_FILE_VERSION;
+    header_.header_bytes = CAPTURE_FILE_HEADER_BYTES;
+    header_.sample_rate = info.sample_rate;
+    header_.channels = info.channels;
+    header_.sample_format = info.s16 ? CAPTURE_FILE_S16 : CAPTURE_FILE_F32;
+    header_.block_frames = CAPTURE_FILE_BLOCK_FRAMES;
+    const size_t data_bytes = (size_t)info.channels * CAPTURE_FILE_BLOCK_FRAMES * sample_bytes(header_.sample_format);
+    header_.block_bytes = (CAPTURE_FILE_BLOCK_HEADER_BYTES + data_bytes + 63) / 64 * 64;
+    header_.speed_of_sound = info.speed_of_sound;
+    header_.mic_count = (uint32_t)std::min<size_t>(info.mic_positions.size(), CAPTURE_FILE_MAX_CHANNELS);
+    for (uint32_t m = 0; m < header_.mic_count; ++m) {
+        header_.mic_positions[m][0] = info.mic_positions[m].first;
+        header_.mic_positions[m][1] = info.mic_positions[m].second;
+    }
+
+    block_.assign(header_.block_bytes, 0);
+    block_fill_ = 0;
+    index_.clear();
+    frames_ = 0;
+    file_bytes_ = 0;
+
+    // Written again with the final counts on close
+    std::vector<char> first(CAPTURE_FILE_HEADER_BYTES, 0);
+    std::memcpy(first.data(), &header_, sizeof(header_));
+    return write_bytes(first.data(), first.size(), error);
+}
+
+bool CaptureFileWriter::write(const CaptureChunk& chunk, std::string& error) {
+    const int channels = header_.channels;
+    const uint32_t block_frames = header_.block_frames;
+    char* data = block_.data() + CAPTURE_FILE_BLOCK_HEADER_BYTES;
+    size_t done = 0;
+    while (done < chunk.frames) {
+        if (block_fill_ == 0) {
+            CaptureFileBlockHeader* block = reinterpret_cast<CaptureFileBlockHeader*>(block_.data());
+            block->first_frame = frames_;
+            block->time_unix_ns = chunk.time_unix_ns == 0 ? 0 : chunk.time_unix_ns + (int64_t)(done * 1e9 / header_.sample_rate);
+            if (frames_ == 0) header_.start_unix_ns = block->time_unix_ns;
+        }
+
+        const size_t n = std::min<size_t>(chunk.frames - done, block_frames - block_fill_);
+        for (int c = 0; c < channels; ++c) {
+            const size_t at = (size_t)c * block_frames + block_fill_;
+            if (header_.sample_format == CAPTURE_FILE_S16) {
+                int16_t* out = reinterpret_cast<int16_t*>(data) + at;
+                if (chunk.s16 != nullptr) {
+                    std::memcpy(out, chunk.s16[c] + done, n * sizeof(int16_t));
+                } else {
+                    convert_f32_to_s16(chunk.f32[c] + done, out, n);
+                }
+            } else {
+                float* out = reinterpret_cast<float*>(data) + at;
+                if (chunk.f32 != nullptr) {
+                    std::memcpy(out, chunk.f32[c] + done, n * sizeof(float));
+                } else {
+                    convert_s16_to_f32(chunk.s16[c] + done, out, n);
+                }
+            }
+        }
+        block_fill_ += (uint32_t)n;
+        frames_ += n;
+        done += n;
+        if (block_fill_ == block_frames && !write_block(error)) return false;
+    }
+    return true;
+}
+
+bool CaptureFileWriter::write_block(std::string& error) {
+    const int channels = header_.channels;
+    const uint32_t block_frames = header_.block_frames;
+    const size_t frames = block_fill_;
+    CaptureFileBlockHeader* block = reinterpret_cast<CaptureFileBlockHeader*>(block_.data());
+    const char* data = block_.data() + CAPTURE_FILE_BLOCK_HEADER_BYTES;
+    block->frames = block_fill_;
+
+    // Level summary, so a viewer can draw an overview or find loud passages without the samples
+    for (int c = 0; c < channels; ++c) {
+        float peak = 0.0f;
+        double energy = 0.0;
+        if (header_.sample_format == CAPTURE_FILE_S16) {
+            const int16_t* in = reinterpret_cast<const int16_t*>(data) + (size_t)c * block_frames;
+            int magnitude = 0;
+            int64_t sum = 0;
+            for (size_t i = 0; i < frames; ++i) {
+                magnitude = std::max(magnitude, std::abs((int)in[i]));
+                sum += (int)in[i] * (int)in[i];
+            }
+            peak = magnitude / 32768.0f;
+            energy = (double)sum / (32768.0 * 32768.0);
+        } else {
+            const float* in = reinterpret_cast<const float*>(data) + (size_t)c * block_frames;
+            for (size_t i = 0; i < frames; ++i) {
+                peak = std::max(peak, std::fabs(in[i]));
+                energy += (double)in[i] * in[i];
+            }
+        }
+        block->peak[c] = peak;
+        block->rms[c] = frames > 0 ? (float)std::sqrt(energy / frames) : 0.0f;
+    }
+
+    // Only the last block is partial; its unused samples are written as zeros
+    if (frames < block_frames) {
+        const size_t size = sample_bytes(header_.sample_format);
+        char* samples = block_.data() + CAPTURE_FILE_BLOCK_HEADER_BYTES;
+        for (int c = 0; c < channels; ++c) {
+            std::memset(samples + ((size_t)c * block_frames + frames) * size, 0, (block_frames - frames) * size);
+        }
+    }
+
+    CaptureFileIndexEntry entry;
+    entry.first_frame = block->first_frame;
+    entry.time_unix_ns = block->time_unix_ns;
+    entry.offset = file_bytes_;
+    index_.push_back(entry);
+    block_fill_ = 0;
+    return write_bytes(block_.data(), block_.size(), error);
+}
+
+bool CaptureFileWriter::write_bytes(const void* data, size_t bytes, std::string& error) {
+    const size_t written = std::fwrite(data, 1, bytes, file_);
+    file_bytes_ += written;
+    if (written == bytes) return true;
+    error = "could not write to " + path_ + " (disk full?)";
+    return false;
+}
+
+bool CaptureFileWriter::close(std::string& error) {
+    if (file_ == nullptr) return true;
+    bool ok = block_fill_ == 0 || write_block(error);
+
+    // The index, then the final header over the provisional one
+    if (ok) {
+        header_.block_count = index_.size();
+        header_.total_frames = frames_;
+        header_.index_offset = file_bytes_;
+        ok = write_bytes(index_.data(), index_.size() * sizeof(CaptureFileIndexEntry), error);
+    }
+    if (ok && (std::fseek(file_, 0, SEEK_SET) != 0 || std::fwrite(&header_, sizeof(header_), 1, file_) != 1)) {
+        error = "could not finish writing " + path_;
+        ok = false;
+    }
+    if (std::fclose(file_) != 0 && ok) {
+        error = "could not finish writing " + path_;
+        ok = false;
+    }
+    file_ = nullptr;
+    return ok;
+}
+
+// --- Reader ---
+bool CaptureFileReader::block_at_time(int64_t unix_ns, uint64_t& block_index, std::string& error) const {
+    if (!has_times()) {
+        error = "the capture has no timestamps to seek by";
+        return false;
+    }
+    // First block captured after unix_ns, minus one
+    uint64_t low = 0;
+    uint64_t high = block_count_;
+    while (low < high) {
+        const uint64_t mid = low + (high - low) / 2;
+        const int64_t time = index_ != nullptr ? index_[mid].time_unix_ns : block(mid).time_unix_ns;
+        if (time <= unix_ns) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    block_index = low > 0 ? low - 1 : 0;
+    return true;
+}
+
+size_t CaptureFileReader::read(uint64_t first_frame, size_t frames, float* const* out) const {
+    if (first_frame >= frame_count_) return 0;
+    frames = (size_t)std::min<uint64_t>(frames, frame_count_ - first_frame);
+    const uint32_t block_frames = header_->block_frames;
+    size_t done = 0;
+    while (done < frames) {
+        const uint64_t frame = first_frame + done;
+        const uint64_t b = frame / block_frames;
+        if (b >= block_count_) break;
+        const size_t offset = (size_t)(frame % block_frames);
+        const size_t n = std::min<size_t>(frames - done, block_frames - offset);
+        for (int c = 0; c < header_->channels; ++c) {
+            if (header_->sample_format == CAPTURE_FILE_S16) {
+                convert_s16_to_f32(channel_s16(b, c) + offset, out[c] + done, n);
+            } else {
+                std::memcpy(out[c] + done, channel_f32(b, c) + offset, n * sizeof(float));
+            }
+        }
+        done += n;
+    }
+    return done;
+}
+
+// --- Platform mapping: mmap, or a read-only file mapping on Windows ---
+#if !defined(_WIN32)
+
+// Maps the whole file read-only and returns its size in `bytes`
+static const void* map_file(const std::string& path, size_t& bytes, std::string& error) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "could not open " + path + ": " + std::strerror(errno);
+        return nullptr;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < CAPTURE_FILE_HEADER_BYTES) {
+        error = path + " is not a binary capture";
+        ::close(fd);
+        return nullptr;
+    }
+    bytes = (size_t)info.st_size;
+    void* mapping = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        error = "could not map " + path + ": " + std::strerror(errno);
+        return nullptr;
+    }
+    return mapping;
+}
+
+static void unmap_file(const void* mapping, size_t bytes) { munmap(const_cast<void*>(mapping), bytes); }
+
+#else
+
+// The view keeps the file and its mapping open, so both handles are closed straight away. Sharing
+// writes lets a capture still being recorded be opened; its complete blocks are read as usual.
+static const void* map_file(const std::string& path, size_t& bytes, std::string& error) {
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        error = "could not open " + path + " (error " + std::to_string(GetLastError()) + ")";
+        return nullptr;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || (uint64_t)size.QuadPart < CAPTURE_FILE_HEADER_BYTES ||
+        (uint64_t)size.QuadPart > (uint64_t)SIZE_MAX) {
+        error = path + " is not a binary capture";
+        CloseHandle(file);
+        return nullptr;
+    }
+    bytes = (size_t)size.QuadPart;
+    HANDLE section = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (section == nullptr) {
+        error = "could not map " + path + " (error " + std::to_string(GetLastError()) + ")";
+        return nullptr;
+    }
+    // Map only the size seen above; a recording in progress may grow meanwhile
+    const void* mapping = MapViewOfFile(section, FILE_MAP_READ, 0, 0, bytes);
+    CloseHandle(section);
+    if (mapping == nullptr) {
+        error = "could not map " + path + " (error " + std::to_string(GetLastError()) + ")";
+        return nullptr;
+    }
+    return mapping;
+}
+
+static void unmap_file(const void* mapping, size_t bytes) {
+    (void)bytes;
+    UnmapViewOfFile(mapping);
+}
+
+#endif
+
+bool CaptureFileReader::open(const std::string& path, std::string& error) {
+    close();
+
+    size_t bytes = 0;
+    const void* mapping = map_file(path, bytes, error);
+    if (mapping == nullptr) return false;
+
+    const CaptureFileHeader* header = static_cast<const CaptureFileHeader*>(mapping);
+    const size_t data_bytes = (size_t)header->channels * header->block_frames * sample_bytes(header->sample_format);
+    std::string problem;
+    if (std::memcmp(header->magic, CAPTURE_FILE_MAGIC, sizeof(header->magic)) != 0) {
+        problem = path + " is not a binary capture";
+    } else if (header->version != CAPTURE_FILE_VERSION) {
+        problem = path + " was written by an incompatible version (format " + std::to_string(header->version) + ")";
+    } else if (header->header_bytes < sizeof(CaptureFileHeader) || header->header_bytes > bytes ||
+               header->channels < 1 || header->channels > CAPTURE_FILE_MAX_CHANNELS || header->block_frames == 0 ||
+               header->sample_format > CAPTURE_FILE_S16 || header->block_bytes < CAPTURE_FILE_BLOCK_HEADER_BYTES + data_bytes) {
+        problem = path + " has a damaged header";
+    }
+    if (!problem.empty()) {
+        error = problem;
+        unmap_file(mapping, bytes);
+        return false;
+    }
+
+    base_ = static_cast<const char*>(mapping);
+    bytes_ = bytes;
+    header_ = header;
+
+    // An unfinished file has no counts or index; its complete blocks are still usable
+    const uint64_t blocks_present = (bytes - header->header_bytes) / header->block_bytes;
+    if (header->block_count > 0 && header->block_count <= blocks_present) {
+        block_count_ = header->block_count;
+        frame_count_ = header->total_frames;
+        if (header->index_offset >= header->header_bytes + block_count_ * header->block_bytes &&
+            header->index_offset + block_count_ * sizeof(CaptureFileIndexEntry) <= bytes) {
+            index_ = reinterpret_cast<const CaptureFileIndexEntry*>(base_ + header->index_offset);
+        }
+    } else {
+        block_count_ = blocks_present;
+        frame_count_ = block_count_ == 0 ? 0 : (block_count_ - 1) * header->block_frames + block(block_count_ - 1).frames;
+    }
+
+    // read() finds frames by arithmetic, so the frame count must lie within the last block. Only the
+    // last block's own count feeds into it; the others are not used for addressing.
+    const uint64_t block_frames = header->block_frames;
+    if (block_count_ > 0 && (block(block_count_ - 1).frames > block_frames ||
+                             frame_count_ > block_count_ * block_frames ||
+                             frame_count_ <= (block_count_ - 1) * block_frames)) {
+        error = path + " has a damaged header";
+        close();
+        return false;
+    }
+    return true;
+}
+
+void CaptureFileReader::close() {
+    if (base_ == nullptr) return;
+    unmap_file(base_, bytes_);
+    base_ = nullptr;
+    header_ = nullptr;
+    index_ = nullptr;
+    block_count_ = 0;
+    frame_count_ = 0;
+}
+
+
+bool load_capture_file(const std::string& path, int channels, int sample_rate, std::vector<float>& interleaved,
+                       std::string& error) {
+    CaptureFileReader reader;
+    if (!reader.open(path, error)) return false;
+    if (reader.header().channels != channels) {
+        error = path + " has " + std::to_string(reader.header().channels) + " channels, expected " + std::to_string(channels);
+        return false;
+    }
+    if (reader.header().sample_rate != sample_rate) {
+        error = path + " was recorded at " + std::to_string(reader.header().sample_rate) + " Hz, expected " +
+                std::to_string(sample_rate) + " Hz";
+        return false;
+    }
+
+    // One block at a time through a planar scratch buffer
+    const size_t block_frames = reader.header().block_frames;
+    std::vector<float> planar(block_frames * channels);
+    float* rows[CAPTURE_FILE_MAX_CHANNELS];
+    for (int c = 0; c < channels; ++c) rows[c] = planar.data() + c * block_frames;
+    interleaved.resize(reader.frame_count() * channels);
+    for (uint64_t frame = 0; frame < reader.frame_count(); frame += block_frames) {
+        const size_t n = reader.read(frame, block_frames, rows);
+        float* out = interleaved.data() + frame * channels;
+        for (size_t i = 0; i < n; ++i) {
+            for (int c = 0; c < channels; ++c) out[i * channels + c] = rows[c][i];
+        }
+    }
+    return true;
+}
@@ -0,0 +1,169 @@
+// =================================================================================================
+// Binary capture container (.u8c)
+// =================================================================================================
+//
+// A compact alternative to the capture CSV: samples are stored as raw float32 or int16 instead of
+// text, so a 10 s 8-channel capture is 15 MB (7.5 MB as int16) rather than ~50 MB of text, and
+// writing or loading it is a memcpy rather than a float formatter / parser per sample.
+//
+// Layout (all values little-endian, as written by the host):
+//
+//   [0, header_bytes)      CaptureFileHeader, zero padded: stream format and array geometry
+//   block b                at header_bytes + b * block_bytes:
+//     CAPTURE_FILE_BLOCK_HEADER_BYTES   CaptureFileBlockHeader, zero padded: first frame, capture
+//                                       time, per-channel peak and RMS
+//     channels * block_frames samples   planar: channel c's samples are contiguous
+//   index                  at index_offset: one CaptureFileIndexEntry per block
+//
+// Every block has the same size (the last one is zero padded), so the block holding frame f is
+// f / block_frames and its offset is arithmetic: a reader maps the file and seeks to any audio time
+// without parsing anything. The index repeats each block's capture time in one contiguous array,
+// for binary searching by wall-clock time (which jumps where the capture dropped frames).
+//
+// The header is rewritten with block_count, total_frames and index_offset when the writer closes.
+// A file whose writer never finished (block_count == 0) is still readable: the reader counts the
+// blocks from the file size and searches the block headers instead of the index.
+// =================================================================================================
+
+#pragma once
+
+#include "capture_writer.hpp" // CaptureSink
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+const char CAPTURE_FILE_MAGIC[8] = "UMA8CAP";
+const uint32_t CAPTURE_FILE_VERSION = 1;
+const uint32_t CAPTURE_FILE_HEADER_BYTES = 4096;      // Offset of block 0
+const uint32_t CAPTURE_FILE_BLOCK_HEADER_BYTES = 256; // Offset of the samples within a block
+const uint32_t CAPTURE_FILE_BLOCK_FRAMES = 4800;      // 100 ms at 48 kHz
+const int CAPTURE_FILE_MAX_CHANNELS = 16;
+
+const uint32_t CAPTURE_FILE_F32 = 0;
+const uint32_t CAPTURE_FILE_S16 = 1; // Full scale is 32768
+
+struct CaptureFileHeader {
+    char magic[8];                     // CAPTURE_FILE_MAGIC
+    uint32_t version;
+    uint32_t header_bytes;
+    int32_t sample_rate;
+    int32_t channels;
+    uint32_t sample_format;            // CAPTURE_FILE_F32 or CAPTURE_FILE_S16
+    uint32_t block_frames;             // Frames per block
+    uint64_t block_bytes;              // Distance between consecutive blocks (a multiple of 64)
+    uint64_t block_count;              // 0 until the writer closes the file
+    uint64_t total_frames;             // 0 until the writer closes the file
+    uint64_t index_offset;             // 0 if there is no index
+    int64_t start_unix_ns;             // System clock time of frame 0; 0 if unknown
+    float speed_of_sound;              // Meters per second; 0 if no geometry was recorded
+    uint32_t mic_count;                // Valid entries in mic_positions
+    float mic_positions[CAPTURE_FILE_MAX_CHANNELS][2]; // x, y in meters, per channel
+};
+
+struct CaptureFileBlockHeader {
+    uint64_t first_frame;              // Index of the block's first frame in the file
+    int64_t time_unix_ns;              // System clock time the first frame was captured; 0 if unknown
+    uint32_t frames;                   // Valid frames: block_frames except in the last block
+    uint32_t reserved;
+    float peak[CAPTURE_FILE_MAX_CHANNELS]; // Largest |sample| per channel, 1.0 = full scale
+    float rms[CAPTURE_FILE_MAX_CHANNELS];
+};
+
+struct CaptureFileIndexEntry {
+    uint64_t first_frame;
+    int64_t time_unix_ns;
+    uint64_t offset;                   // Of the block, from the start of the file
+};
+
+static_assert(sizeof(CaptureFileHeader) == 208, "the header layout is part of the file format");
+static_assert(sizeof(CaptureFileBlockHeader) == 152, "the block header layout is part of the file format");
+static_assert(sizeof(CaptureFileIndexEntry) == 24, "the index layout is part of the file format");
+
+// True if `path` starts with CAPTURE_FILE_MAGIC
+bool is_capture_file(const std::string& path);
+
+// Writes one .u8c file. Blocks are assembled from chunks of any size, so chunk boundaries do not
+// show in the file; each complete block is written with a single write.
+class CaptureFileWriter : public CaptureSink {
+public:
+    ~CaptureFileWriter() override;
+
+    bool open(const std::string& path, const CaptureStreamInfo& info, std::string& error) override;
+    bool write(const CaptureChunk& chunk, std::string& error) override;
+    bool close(std::string& error) override;
+
+    uint64_t bytes_written() const override { return file_bytes_; }
+
+private:
+    bool write_block(std::string& error);
+    bool write_bytes(const void* data, size_t bytes, std::string& error);
+
+    std::FILE* file_ = nullptr;
+    std::string path_;
+    CaptureFileHeader header_ = {};
+    std::vector<char> block_;          // The block being assembled, header included
+    uint32_t block_fill_ = 0;          // Frames in block_ so far
+    std::vector<CaptureFileIndexEntry> index_;
+    uint64_t frames_ = 0;
+    uint64_t file_bytes_ = 0;
+};
+
+// Read-only view of a .u8c file, mapped into memory (mmap, or a file mapping on Windows). Sample
+// pointers point into the mapping, so they are valid until close().
+class CaptureFileReader {
+public:
+    CaptureFileReader() = default;
+    CaptureFileReader(const CaptureFileReader&) = delete;
+    CaptureFileReader& operator=(const CaptureFileReader&) = delete;
+    ~CaptureFileReader() { close(); }
+
+    bool open(const std::string& path, std::string& error);
+    void close();
+
+    const CaptureFileHeader& header() const { return *header_; }
+    uint64_t block_count() const { return block_count_; }
+    uint64_t frame_count() const { return frame_count_; }
+    bool has_index() const { return index_ != nullptr; }
+
+    const CaptureFileBlockHeader& block(uint64_t b) const {
+        return *reinterpret_cast<const CaptureFileBlockHeader*>(block_base(b));
+    }
+    // Channel c of block b: block_frames samples of the header's sample format
+    const float* channel_f32(uint64_t b, int c) const {
+        return reinterpret_cast<const float*>(block_base(b) + CAPTURE_FILE_BLOCK_HEADER_BYTES) + (size_t)c * header_->block_frames;
+    }
+    const int16_t* channel_s16(uint64_t b, int c) const {
+        return reinterpret_cast<const int16_t*>(block_base(b) + CAPTURE_FILE_BLOCK_HEADER_BYTES) + (size_t)c * header_->block_frames;
+    }
+
+    // True if the blocks carry capture times (the writer was given them)
+    bool has_times() const { return block_count_ > 0 && block(0).time_unix_ns != 0; }
+
+    // Seeking: the block holding a frame, or the last block captured at or before a system clock
+    // time (block 0 if the time is earlier than the whole capture). Seeking by time fails on a
+    // file without capture times.
+    uint64_t block_at_frame(uint64_t frame) const { return frame / header_->block_frames; }
+    bool block_at_time(int64_t unix_ns, uint64_t& block, std::string& error) const;
+
+    // Copies up to `frames` frames starting at `first_frame` into planar float arrays, converting
+    // int16 to [-1, 1). Returns the number copied (fewer at the end of the file).
+    size_t read(uint64_t first_frame, size_t frames, float* const* out) const;
+
+private:
+    const char* block_base(uint64_t b) const { return base_ + header_->header_bytes + b * header_->block_bytes; }
+
+    const char* base_ = nullptr;
+    size_t bytes_ = 0;
+    const CaptureFileHeader* header_ = nullptr;
+    const CaptureFileIndexEntry* index_ = nullptr;
+    uint64_t block_count_ = 0;
+    uint64_t frame_count_ = 0;
+};
+
+// Loads a whole .u8c capture into interleaved float frames, like load_capture_csv. Fails if the
+// file does not have exactly `channels` channels at `sample_rate`.
+bool load_capture_file(const std::string& path, int channels, int sample_rate, std::vector<float>& interleaved,
+                       std::string& error);
@@ -0,0 +1,214 @@
+#include "capture_io.hpp"
+#include "planar_ring.hpp" // PLANAR_MAX_CHANNELS
+
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+const size_t MIN_PARSE_CHUNK_BYTES = 1 << 20; // Smaller files are not worth another thread
+
+// --- Loading ---
+
+// One thread's share of the rows: whole lines [begin, end)
+struct CsvChunk {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+    size_t lines = 0;      // Lines in the chunk, blank ones included (for error messages)
+    size_t rows = 0;       // Non-blank lines
+    size_t first_line = 0; // File line number (1-based, the header is line 1) of the chunk's first line
+    size_t first_row = 0;  // Index of the chunk's first row in the output
+    std::string error;
+};
+
+static bool read_whole_file(const std::string& path, std::string& text, std::string& error) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        error = "could not open " + path;
+        return false;
+    }
+    const std::streamoff size = file.tellg();
+    text.resize((size_t)std::max<std::streamoff>(size, 0));
+    file.seekg(0);
+    if (!file.read(&text[0], (std::streamsize)text.size())) {
+        error = "could not read " + path;
+        return false;
+    }
+    return true;
+}
+
+// A line without its terminator, or nothing if it is blank
+static inline const char* line_content_end(const char* line, const char* line_end) {
+    if (line_end > line && line_end[-1] == '\r') --line_end;
+    return line_end;
+}
+
+static void count_rows(CsvChunk& chunk) {
+    const char* p = chunk.begin;
+    while (p < chunk.end) {
+        const char* newline = static_cast<const char*>(std::memchr(p, '\n', chunk.end - p));
+        const char* line_end = newline ? newline : chunk.end;
+        ++chunk.lines;
+        if (line_content_end(p, line_end) > p) ++chunk.rows;
+        p = line_end + 1;
+    }
+}
+
+// Parses the chunk's rows with std::from_chars, handing each value to store(row, channel, value)
+template <typename Store>
+static void parse_rows(CsvChunk& chunk, int channels, const std::string& path, Store store) {
+    const char* p = chunk.begin;
+    size_t line = chunk.first_line;
+    size_t row = chunk.first_row;
+    while (p < chunk.end) {
+        const char* newline = static_cast<const char*>(std::memchr(p, '\n', chunk.end - p));
+        const char* line_end = line_content_end(p, newline ? newline : chunk.end);
+        const char* next = (newline ? newline : chunk.end) + 1;
+        if (line_end == p) {
+            p = next;
+            ++line;
+            continue;
+        }
+        for (int c = 0; c < channels; ++c) {
+            while (p < line_end && (*p == ' ' || *p == '\t' || *p == '+')) ++p; // from_chars takes neither
+            float value = 0.0f;
+            const std::from_chars_result parsed = std::from_chars(p, line_end, value);
+            if (parsed.ec == std::errc::result_out_of_range) {
+                value = std::strtof(std::string(p, parsed.ptr).c_str(), nullptr); // Rounds to 0 or inf as before
+            } else if (parsed.ec != std::errc()) {
+                chunk.error = path + ": row " + std::to_string(line) + " has fewer than " + std::to_string(channels) + " values";
+                return;
+            }
+            store(row, c, value);
+            p = parsed.ptr;
+            while (p < line_end && (*p == ' ' || *p == '\t')) ++p;
+            if (p < line_end && *p == ',') ++p;
+        }
+        if (p < line_end) {
+            chunk.error = path + ": row " + std::to_string(line) + " has more than " + std::to_string(channels) + " values";
+            return;
+        }
+        ++row;
+        ++line;
+        p = next;
+    }
+}
+
+// Reads the file, splits the rows after the header into chunks on line boundaries and counts them
+// in parallel. Calls allocate(total_rows), then parses the chunks in parallel with store.
+template <typename Allocate, typename Store>
+static bool load_csv_parallel(const std::string& path, int channels, int threads, std::string& error,
+                              Allocate allocate, Store store) {
+    std::string text;
+    if (!read_whole_file(path, text, error)) return false;
+    const char* const data = text.data();
+    const char* const data_end = data + text.size();
+
+    // Header row
+    const char* header_end = static_cast<const char*>(std::memchr(data, '\n', text.size()));
+    const char* body = header_end ? header_end + 1 : data_end;
+    const size_t body_bytes = data_end - body;
+
+    if (threads <= 0) threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    threads = (int)std::max<size_t>(1, std::min<size_t>(threads, body_bytes / MIN_PARSE_CHUNK_BYTES));
+    std::vector<CsvChunk> chunks(threads);
+    const char* start = body;
+    for (int t = 0; t < threads; ++t) {
+        const char* end = t == threads - 1 ? data_end : std::max(start, body + body_bytes * (t + 1) / threads);
+        if (end < data_end) {
+            const char* newline = static_cast<const char*>(std::memchr(end, '\n', data_end - end));
+            end = newline ? newline + 1 : data_end;
+        }
+        chunks[t].begin = start;
+        chunks[t].end = end;
+        start = end;
+    }
+
+    auto run = [&](auto&& work) {
+        std::vector<std::thread> workers;
+        for (int t = 1; t < threads; ++t) workers.emplace_back(work, t);
+        work(0);
+        for (std::thread& worker : workers) worker.join();
+    };
+
+    run([&](int t) { count_rows(chunks[t]); });
+    size_t line = 2;
+    size_t rows = 0;
+    for (CsvChunk& chunk : chunks) {
+        chunk.first_line = line;
+        chunk.first_row = rows;
+        line += chunk.lines;
+        rows += chunk.rows;
+    }
+
+    allocate(rows);
+    run([&](int t) { parse_rows(chunks[t], channels, path, store); });
+    for (const CsvChunk& chunk : chunks) {
+        if (!chunk.error.empty()) {
+            error = chunk.error;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool load_capture_csv(const std::string& path, int channels, std::vector<float>& interleaved, std::string& error,
+                      int threads) {
+    float* out = nullptr;
+    return load_csv_parallel(path, channels, threads, error,
+        [&](size_t rows) {
+            interleaved.assign(rows * channels, 0.0f);
+            out = interleaved.data();
+        },
+        [&](size_t row, int c, float value) { out[row * channels + c] = value; });
+}
+
+bool load_capture_csv_planar(const std::string& path, int channels, std::vector<std::vector<float>>& planar,
+                             std::string& error, int threads) {
+    if (channels < 1 || channels > PLANAR_MAX_CHANNELS) {
+        error = "planar loading supports 1 to " + std::to_string(PLANAR_MAX_CHANNELS) + " channels, not " +
+                std::to_string(channels);
+        return false;
+    }
+    float* out[PLANAR_MAX_CHANNELS];
+    return load_csv_parallel(path, channels, threads, error,
+        [&](size_t rows) {
+            planar.assign(channels, std::vector<float>(rows));
+            for (int c = 0; c < channels; ++c) out[c] = planar[c].data();
+        },
+        [&](size_t row, int c, float value) { out[c][row] = value; });
+}
+
+// --- Formatting ---
+void append_csv_header(int channels, std::string& out) {
+    for (int c = 0; c < channels; ++c) {
+        out += "Channel_" + std::to_string(c);
+        out += (c == channels - 1 ? '\n' : ',');
+    }
+}
+
+// Formats straight into `out`, sized for the longest possible rows and trimmed afterwards
+template <typename T>
+static void append_rows(const T* const* planar, int channels, size_t frames, size_t max_value_chars, std::string& out) {
+    size_t pos = out.size();
+    out.resize(pos + frames * channels * (max_value_chars + 1));
+    char* p = &out[pos];
+    char* const end = &out[0] + out.size();
+    for (size_t i = 0; i < frames; ++i) {
+        for (int c = 0; c < channels; ++c) {
+            p = std::to_chars(p, end, planar[c][i]).ptr;
+            *p++ = (c == channels - 1 ? '\n' : ',');
+        }
+    }
+    out.resize(p - &out[0]);
+}
+
+void append_csv_rows(const float* const* planar, int channels, size_t frames, std::string& out) {
+    append_rows(planar, channels, frames, 16, out); // "-1.2345678e-38" fits comfortably
+}
+
+void append_csv_rows(const double* const* planar, int channels, size_t frames, std::string& out) {
+    append_rows(planar, channels, frames, 24, out); // "-2.2250738585072014e-308"
+}
@@ -0,0 +1,36 @@
+// =================================================================================================
+// Reading and writing UMA-8 capture files
+// =================================================================================================
+//
+// Captures are stored as a header row followed by one row of comma separated samples per frame
+// (the format written by tdoa_capture, tdoa_realtime --record and tdoa_synth).
+//
+// Loading reads the whole file with one read, splits the rows into one chunk per thread on line
+// boundaries, counts each chunk's rows in parallel to place it in the output, then parses the
+// chunks in parallel with std::from_chars. A multi-million-row capture loads at close to disk speed.
+// =================================================================================================
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Loads a CSV capture into interleaved frames (c0 c1 ... c7 c0 c1 ...). Fails if any row does not
+// have exactly `channels` values; blank lines are skipped. `threads` parse in parallel (0: one per
+// hardware thread; small files use fewer). Returns false and fills `error` on failure.
+bool load_capture_csv(const std::string& path, int channels, std::vector<float>& interleaved, std::string& error,
+                      int threads = 0);
+
+// As load_capture_csv, into one buffer per channel (planar[c][frame]). Fails unless
+// 1 <= channels <= PLANAR_MAX_CHANNELS.
+bool load_capture_csv_planar(const std::string& path, int channels, std::vector<std::vector<float>>& planar,
+                             std::string& error, int threads = 0);
+
+// Appends the "Channel_0,...,Channel_N" header row.
+void append_csv_header(int channels, std::string& out);
+
+// Appends one CSV row per frame, reading sample i of channel c from planar[c][i]. Values are
+// formatted with std::to_chars (shortest round-trip form), so no precision is lost.
+void append_csv_rows(const float* const* planar, int channels, size_t frames, std::string& out);
+void append_csv_rows(const double* const* planar, int channels, size_t frames, std::string& out);
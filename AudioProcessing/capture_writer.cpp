@@ -0,0 +1,350 @@
+#include "capture_writer.hpp"
+#include "capture_io.hpp"  // append_csv_header, append_csv_rows
+#include "planar_ring.hpp" // convert_s16_to_f32, convert_f32_to_s16, PLANAR_MAX_CHANNELS
+#include "capture_file.hpp" // CaptureFileWriter
+#include "capture_compress.hpp" // CompressedCaptureWriter
+#include "miniaudio.h"        // ma_encoder; the implementation is compiled by the program
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+const size_t WRITE_BATCH_BYTES = 1 << 20; // Output collected before each write
+const uint64_t WAV_MAX_BYTES = 0xF0000000; // RIFF sizes are 32-bit; rotate well before 4 GB (~43 min at 8 x f32)
+
+bool parse_capture_file_format(const std::string& text, CaptureFileFormat& format) {
+    if (text == "csv") {
+        format = CaptureFileFormat::Csv;
+    } else if (text == "binary") {
+        format = CaptureFileFormat::Binary;
+    } else if (text == "wav") {
+        format = CaptureFileFormat::Wav;
+    } else if (text == "compressed") {
+        format = CaptureFileFormat::Compressed;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* capture_file_format_name(CaptureFileFormat format) {
+    switch (format) {
+        case CaptureFileFormat::Csv: return "csv";
+        case CaptureFileFormat::Binary: return "binary";
+        case CaptureFileFormat::Wav: return "wav";
+        case CaptureFileFormat::Compressed: return "compressed";
+    }
+    return "?";
+}
+
+static bool ends_with(const std::string& text, const char* suffix) {
+    const size_t length = std::strlen(suffix);
+    if (text.size() < length) return false;
+    for (size_t i = 0; i < length; ++i) {
+        if (std::tolower((unsigned char)text[text.size() - length + i]) != suffix[i]) return false;
+    }
+    return true;
+}
+
+CaptureFileFormat capture_file_format_for_path(const std::string& path) {
+    if (ends_with(path, ".wav")) return CaptureFileFormat::Wav;
+    if (ends_with(path, ".u8c")) return CaptureFileFormat::Binary;
+    if (ends_with(path, ".u8z")) return CaptureFileFormat::Compressed;
+    return CaptureFileFormat::Csv;
+}
+
+// --- CSV: the text format of tdoa_capture and --replay ---
+class CsvCaptureSink : public CaptureSink {
+public:
+    ~CsvCaptureSink() override {
+        std::string ignored;
+        close(ignored);
+    }
+
+    bool open(const std::string& path, const CaptureStreamInfo& info, std::string& error) override {
+        if (info.channels < 1 || info.channels > PLANAR_MAX_CHANNELS) {
+            error = "the CSV writer holds 1 to " + std::to_string(PLANAR_MAX_CHANNELS) + " channels";
+            return false;
+        }
+        file_ = std::fopen(path.c_str(), "wb");
+        if (file_ == nullptr) {
+            error = "could not open " + path + " for writing";
+            return false;
+        }
+        std::setvbuf(file_, nullptr, _IONBF, 0); // batch_ is the only buffer
+        path_ = path;
+        channels_ = info.channels;
+        file_bytes_ = 0;
+        batch_.clear();
+        batch_.reserve(WRITE_BATCH_BYTES + 64 * 1024);
+        append_csv_header(channels_, batch_);
+        return true;
+    }
+
+    bool write(const CaptureChunk& chunk, std::string& error) override {
+        const float* planar[PLANAR_MAX_CHANNELS];
+        if (chunk.s16 != nullptr) {
+            // Scaled to [-1, 1) floats, as every reader of the CSV expects
+            widened_.resize(chunk.frames * channels_);
+            for (int c = 0; c < channels_; ++c) {
+                float* channel = widened_.data() + c * chunk.frames;
+                convert_s16_to_f32(chunk.s16[c], channel, chunk.frames);
+                planar[c] = channel;
+            }
+        } else {
+            for (int c = 0; c < channels_; ++c) planar[c] = chunk.f32[c];
+        }
+        append_csv_rows(planar, channels_, chunk.frames, batch_);
+        return batch_.size() < WRITE_BATCH_BYTES || flush(error);
+    }
+
+    bool close(std::string& error) override {
+        if (file_ == nullptr) return true;
+        bool ok = flush(error);
+        if (std::fclose(file_) != 0 && ok) {
+            error = "could not finish writing " + path_;
+            ok = false;
+        }
+        file_ = nullptr;
+        return ok;
+    }
+
+    uint64_t bytes_written() const override { return file_bytes_ + batch_.size(); }
+
+private:
+    bool flush(std::string& error) {
+        if (batch_.empty()) return true;
+        const size_t written = std::fwrite(batch_.data(), 1, batch_.size(), file_);
+        file_bytes_ += written;
+        const bool ok = written == batch_.size();
+        batch_.clear();
+        if (!ok) error = "could not write to " + path_ + " (disk full?)";
+        return ok;
+    }
+
+    std::FILE* file_ = nullptr;
+    std::string path_;
+    int channels_ = 0;
+    uint64_t file_bytes_ = 0;
+    std::string batch_;
+    std::vector<float> widened_;
+};
+
+// --- WAV: 32-bit float or 16-bit PCM through miniaudio's encoder ---
+template <typename Sample>
+static void interleave(const Sample* const* planar, int channels, size_t frames, Sample* out) {
+    for (size_t i = 0; i < frames; ++i) {
+        for (int c = 0; c < channels; ++c) out[i * channels + c] = planar[c][i];
+    }
+}
+
+class WavCaptureSink : public CaptureSink {
+public:
+    ~WavCaptureSink() override {
+        std::string ignored;
+        close(ignored);
+    }
+
+    bool open(const std::string& path, const CaptureStreamInfo& info, std::string& error) override {
+        file_ = std::fopen(path.c_str(), "wb");
+        if (file_ == nullptr) {
+            error = "could not open " + path + " for writing";
+            return false;
+        }
+        std::setvbuf(file_, nullptr, _IOFBF, WRITE_BATCH_BYTES); // Gathers the encoder's writes into large ones
+        path_ = path;
+        channels_ = info.channels;
+        s16_ = info.s16;
+        position_ = 0;
+        file_bytes_ = 0;
+        failed_ = false;
+
+        ma_encoder_config config = ma_encoder_config_init(ma_encoding_format_wav, s16_ ? ma_format_s16 : ma_format_f32,
+                                                          (ma_uint32)info.channels, (ma_uint32)info.sample_rate);
+        if (ma_encoder_init(on_write, on_seek, this, &config, &encoder_) != MA_SUCCESS) {
+            std::fclose(file_);
+            file_ = nullptr;
+            error = "could not start a WAV file at " + path;
+            return false;
+        }
+        return true;
+    }
+
+    bool write(const CaptureChunk& chunk, std::string& error) override {
+        // Interleaved in the file's sample format
+        if (chunk.s16 != nullptr) {
+            interleaved_s16_.resize(chunk.frames * channels_);
+            interleave(chunk.s16, channels_, chunk.frames, interleaved_s16_.data());
+            if (!s16_) {
+                interleaved_f32_.resize(interleaved_s16_.size());
+                convert_s16_to_f32(interleaved_s16_.data(), interleaved_f32_.data(), interleaved_s16_.size());
+            }
+        } else {
+            interleaved_f32_.resize(chunk.frames * channels_);
+            interleave(chunk.f32, channels_, chunk.frames, interleaved_f32_.data());
+            if (s16_) {
+                interleaved_s16_.resize(interleaved_f32_.size());
+                convert_f32_to_s16(interleaved_f32_.data(), interleaved_s16_.data(), interleaved_f32_.size());
+            }
+        }
+        const void* frames = s16_ ? (const void*)interleaved_s16_.data() : (const void*)interleaved_f32_.data();
+
+        ma_uint64 written = 0;
+        if (ma_encoder_write_pcm_frames(&encoder_, frames, chunk.frames, &written) != MA_SUCCESS ||
+            written != chunk.frames || failed_) {
+            error = "could not write to " + path_ + " (disk full?)";
+            return false;
+        }
+        return true;
+    }
+
+    bool close(std::string& error) override {
+        if (file_ == nullptr) return true;
+        ma_encoder_uninit(&encoder_); // Fills in the RIFF and data chunk sizes
+        bool ok = !failed_;
+        if (std::fclose(file_) != 0) ok = false;
+        file_ = nullptr;
+        if (!ok) error = "could not finish writing " + path_;
+        return ok;
+    }
+
+    uint64_t bytes_written() const override { return file_bytes_; }
+    uint64_t max_file_bytes() const override { return WAV_MAX_BYTES; }
+
+private:
+    static ma_result on_write(ma_encoder* encoder, const void* data, size_t bytes, size_t* written) {
+        WavCaptureSink* sink = static_cast<WavCaptureSink*>(encoder->pUserData);
+        *written = std::fwrite(data, 1, bytes, sink->file_);
+        sink->position_ += *written;
+        sink->file_bytes_ = std::max(sink->file_bytes_, sink->position_);
+        if (*written == bytes) return MA_SUCCESS;
+        sink->failed_ = true;
+        return MA_IO_ERROR;
+    }
+
+    // Only used to go back and patch the header sizes, which lie in the first few hundred bytes
+    static ma_result on_seek(ma_encoder* encoder, ma_int64 offset, ma_seek_origin origin) {
+        WavCaptureSink* sink = static_cast<WavCaptureSink*>(encoder->pUserData);
+        int whence = SEEK_SET;
+        uint64_t position = (uint64_t)offset;
+        if (origin == ma_seek_origin_current) {
+            whence = SEEK_CUR;
+            position = sink->position_ + offset;
+        } else if (origin == ma_seek_origin_end) {
+            whence = SEEK_END;
+            position = sink->file_bytes_ + offset;
+        }
+        if (std::fseek(sink->file_, (long)offset, whence) != 0) {
+            sink->failed_ = true;
+            return MA_IO_ERROR;
+        }
+        sink->position_ = position;
+        return MA_SUCCESS;
+    }
+
+    std::FILE* file_ = nullptr;
+    std::string path_;
+    int channels_ = 0;
+    bool s16_ = false;
+    ma_encoder encoder_;
+    uint64_t position_ = 0;
+    uint64_t file_bytes_ = 0;
+    bool failed_ = false;
+    std::vector<float> interleaved_f32_;
+    std::vector<int16_t> interleaved_s16_;
+};
+
+std::unique_ptr<CaptureSink> make_capture_sink(CaptureFileFormat format) {
+    switch (format) {
+        case CaptureFileFormat::Csv: return std::unique_ptr<CaptureSink>(new CsvCaptureSink());
+        case CaptureFileFormat::Binary: return std::unique_ptr<CaptureSink>(new CaptureFileWriter());
+        case CaptureFileFormat::Wav: return std::unique_ptr<CaptureSink>(new WavCaptureSink());
+        case CaptureFileFormat::Compressed: return std::unique_ptr<CaptureSink>(new CompressedCaptureWriter());
+    }
+    return nullptr;
+}
+
+// --- Rotation ---
+bool RotatingCaptureWriter::open(const std::string& path, CaptureFileFormat format, const CaptureStreamInfo& info,
+                                 const CaptureRotation& rotation, std::string& error) {
+    if (info.channels < 1 || info.channels > PLANAR_MAX_CHANNELS) {
+        error = "capture writing holds 1 to " + std::to_string(PLANAR_MAX_CHANNELS) + " channels";
+        return false;
+    }
+    path_ = path;
+    format_ = format;
+    info_ = info;
+    rotation_ = rotation;
+    file_index_ = -1;
+    total_frames_ = 0;
+    finished_bytes_ = 0;
+    return start_file(error);
+}
+
+std::string RotatingCaptureWriter::file_path(int index) const {
+    if (index == 0 && !rotation_.enabled()) return path_;
+    char number[16];
+    snprintf(number, sizeof(number), "_%03d", index);
+    const size_t dot = path_.find_last_of('.');
+    const size_t slash = path_.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return path_ + number;
+    return path_.substr(0, dot) + number + path_.substr(dot);
+}
+
+bool RotatingCaptureWriter::start_file(std::string& error) {
+    if (sink_) {
+        finished_bytes_ += sink_->bytes_written();
+        if (!sink_->close(error)) return false;
+    }
+    ++file_index_;
+    current_path_ = file_path(file_index_);
+    sink_ = make_capture_sink(format_);
+    file_frames_ = 0;
+    return sink_->open(current_path_, info_, error);
+}
+
+bool RotatingCaptureWriter::write(const CaptureChunk& chunk, std::string& error) {
+    const uint64_t max_frames = (uint64_t)(rotation_.max_seconds * info_.sample_rate);
+    CaptureChunk part = chunk;
+    const float* f32[PLANAR_MAX_CHANNELS];
+    const int16_t* s16[PLANAR_MAX_CHANNELS];
+    uint64_t max_bytes = rotation_.max_bytes;
+    const uint64_t format_limit = sink_->max_file_bytes();
+    if (format_limit > 0 && (max_bytes == 0 || format_limit < max_bytes)) max_bytes = format_limit;
+    while (part.frames > 0) {
+        const bool file_full = (max_bytes > 0 && sink_->bytes_written() >= max_bytes) ||
+                               (max_frames > 0 && file_frames_ >= max_frames);
+        if (file_full && file_frames_ > 0 && !start_file(error)) return false;
+
+        // Up to the duration limit of this file
+        size_t frames = part.frames;
+        if (max_frames > 0) frames = (size_t)std::min<uint64_t>(frames, max_frames - file_frames_);
+        CaptureChunk piece = part;
+        piece.frames = frames;
+        if (!sink_->write(piece, error)) return false;
+        file_frames_ += frames;
+        total_frames_ += frames;
+
+        // The remainder continues in the next file
+        part.frames -= frames;
+        part.first_frame += frames;
+        if (part.time_unix_ns != 0) part.time_unix_ns += (int64_t)(frames * 1e9 / info_.sample_rate);
+        for (int c = 0; c < info_.channels; ++c) {
+            if (part.f32 != nullptr) f32[c] = part.f32[c] + frames;
+            if (part.s16 != nullptr) s16[c] = part.s16[c] + frames;
+        }
+        if (part.f32 != nullptr) part.f32 = f32;
+        if (part.s16 != nullptr) part.s16 = s16;
+    }
+    return true;
+}
+
+bool RotatingCaptureWriter::close(std::string& error) {
+    if (!sink_) return true;
+    finished_bytes_ += sink_->bytes_written();
+    const bool ok = sink_->close(error);
+    sink_.reset();
+    return ok;
+}
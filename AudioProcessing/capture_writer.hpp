@@ -0,0 +1,109 @@
+// =================================================================================================
+// Streaming capture output with file rotation
+// =================================================================================================
+//
+// A recording is written as it is captured, one chunk of planar audio at a time, so its length is
+// limited by the disk rather than by RAM. Each output format is a CaptureSink that owns one open
+// file; RotatingCaptureWriter starts a new numbered file whenever the current one reaches a size
+// or duration limit, so a whole shift can be recorded as a series of self-contained files.
+//
+// The WAV sink uses miniaudio's encoder, so a program linking capture_writer.cpp must compile
+// miniaudio with MINIAUDIO_IMPLEMENTATION (tdoa_capture and tdoa_realtime both do).
+//
+// Not thread-safe: one writer thread drives a writer and its sinks.
+// =================================================================================================
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+enum class CaptureFileFormat { Csv, Binary, Wav, Compressed };
+
+bool parse_capture_file_format(const std::string& text, CaptureFileFormat& format);
+const char* capture_file_format_name(CaptureFileFormat format);
+
+// The format a file name implies: .wav is WAV, .u8c binary, .u8z compressed, anything else CSV
+CaptureFileFormat capture_file_format_for_path(const std::string& path);
+
+// A run of frames in planar form, in the capture's sample format: exactly one of f32 / s16 is set,
+// holding one pointer per channel
+struct CaptureChunk {
+    const float* const* f32 = nullptr;
+    const int16_t* const* s16 = nullptr;
+    size_t frames = 0;
+    uint64_t first_frame = 0; // Index of the chunk's first frame since the capture started
+    int64_t time_unix_ns = 0; // System clock time the first frame was captured; 0 if unknown
+};
+
+struct CaptureStreamInfo {
+    int sample_rate = 0;
+    int channels = 0;
+    bool s16 = false;         // Sample format for formats that store it (the CSV is always float)
+    float speed_of_sound = 0.0f;
+    std::vector<std::pair<float, float>> mic_positions; // Array geometry in meters, if known
+};
+
+// One output file in one format
+class CaptureSink {
+public:
+    virtual ~CaptureSink() = default;
+
+    // Each returns false and fills `error` on failure
+    virtual bool open(const std::string& path, const CaptureStreamInfo& info, std::string& error) = 0;
+    virtual bool write(const CaptureChunk& chunk, std::string& error) = 0;
+    virtual bool close(std::string& error) = 0;
+
+    virtual uint64_t bytes_written() const = 0; // Including data still buffered for the file
+    virtual uint64_t max_file_bytes() const { return 0; } // Largest file the format can hold; 0 if unlimited
+};
+
+std::unique_ptr<CaptureSink> make_capture_sink(CaptureFileFormat format);
+
+// When to start the next file; 0 disables a limit
+struct CaptureRotation {
+    uint64_t max_bytes = 0;
+    double max_seconds = 0.0;
+
+    bool enabled() const { return max_bytes > 0 || max_seconds > 0.0; }
+};
+
+class RotatingCaptureWriter {
+public:
+    // Without rotation the capture goes to `path` itself; with rotation to numbered files
+    // PATH_000.EXT, PATH_001.EXT, ... Opens the first file. A format with a size limit (WAV) rotates
+    // at that limit regardless; without requested rotation, only the files after the first are
+    // numbered (PATH.EXT, PATH_001.EXT, ...). Fails for more than PLANAR_MAX_CHANNELS channels.
+    bool open(const std::string& path, CaptureFileFormat format, const CaptureStreamInfo& info,
+              const CaptureRotation& rotation, std::string& error);
+
+    // Appends a chunk, moving on to the next file first if the current one is full. Duration
+    // limits are exact: a chunk that crosses one is split between the two files.
+    bool write(const CaptureChunk& chunk, std::string& error);
+
+    bool close(std::string& error);
+
+    int files_started() const { return file_index_ + 1; }
+    uint64_t frames_written() const { return total_frames_; }
+    uint64_t bytes_written() const { return finished_bytes_ + (sink_ ? sink_->bytes_written() : 0); }
+    const std::string& current_path() const { return current_path_; }
+
+private:
+    std::string file_path(int index) const;
+    bool start_file(std::string& error);
+
+    std::string path_;
+    CaptureFileFormat format_ = CaptureFileFormat::Csv;
+    CaptureStreamInfo info_;
+    CaptureRotation rotation_;
+    std::unique_ptr<CaptureSink> sink_;
+    std::string current_path_;
+    int file_index_ = -1;
+    uint64_t file_frames_ = 0;
+    uint64_t total_frames_ = 0;
+    uint64_t finished_bytes_ = 0; // Bytes in files already closed
+};
@@ -0,0 +1,126 @@
+#define _USE_MATH_DEFINES //added due to math error
+#include "decimator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    #include <xmmintrin.h>
+    #define DECIMATOR_SSE 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define DECIMATOR_NEON 1
+#endif
+
+Decimator::Decimator(int channels, int factor)
+    : channels_(channels), factor_(std::max(1, factor)) {
+    if (factor_ == 1) return;
+
+    // Blackman-windowed sinc with its cutoff at the output Nyquist frequency, unity gain at DC
+    const int tap_count = factor_ * TAPS_PER_PHASE;
+    const double cutoff = 0.5 / factor_; // Fraction of the input sample rate
+    const double centre = (tap_count - 1) / 2.0;
+    taps_.resize(tap_count);
+    double sum = 0.0;
+    for (int n = 0; n < tap_count; ++n) {
+        const double x = n - centre;
+        const double sinc = x == 0.0 ? 1.0 : std::sin(2.0 * M_PI * cutoff * x) / (2.0 * M_PI * cutoff * x);
+        const double phase = 2.0 * M_PI * n / (tap_count - 1);
+        const double blackman = 0.42 - 0.5 * std::cos(phase) + 0.08 * std::cos(2.0 * phase);
+        taps_[n] = (float)(sinc * blackman);
+        sum += taps_[n];
+    }
+    for (float& tap : taps_) tap = (float)(tap / sum);
+
+    // The stream starts from silence
+    buffer_.assign((tap_count - 1 + BLOCK_FRAMES) * channels_, 0.0f);
+    buffered_ = tap_count - 1;
+    next_output_ = tap_count - 1;
+}
+
+// Computes one output frame from the taps_.size() input frames starting at `first`. The filter is
+// symmetric, so no tap reversal is needed.
+void Decimator::filter_frame(const float* first, float* out) const {
+    const int tap_count = (int)taps_.size();
+    const size_t stride = channels_;
+    int c = 0;
+#if defined(DECIMATOR_SSE)
+    for (; c + 8 <= channels_; c += 8) {
+        __m128 acc0 = _mm_setzero_ps();
+        __m128 acc1 = _mm_setzero_ps();
+        const float* x = first + c;
+        for (int k = 0; k < tap_count; ++k, x += stride) {
+            const __m128 tap = _mm_set1_ps(taps_[k]);
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(tap, _mm_loadu_ps(x)));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(tap, _mm_loadu_ps(x + 4)));
+        }
+        _mm_storeu_ps(out + c, acc0);
+        _mm_storeu_ps(out + c + 4, acc1);
+    }
+    for (; c + 4 <= channels_; c += 4) {
+        __m128 acc = _mm_setzero_ps();
+        const float* x = first + c;
+        for (int k = 0; k < tap_count; ++k, x += stride) {
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(taps_[k]), _mm_loadu_ps(x)));
+        }
+        _mm_storeu_ps(out + c, acc);
+    }
+#elif defined(DECIMATOR_NEON)
+    for (; c + 8 <= channels_; c += 8) {
+        float32x4_t acc0 = vdupq_n_f32(0.0f);
+        float32x4_t acc1 = vdupq_n_f32(0.0f);
+        const float* x = first + c;
+        for (int k = 0; k < tap_count; ++k, x += stride) {
+            acc0 = vmlaq_n_f32(acc0, vld1q_f32(x), taps_[k]);
+            acc1 = vmlaq_n_f32(acc1, vld1q_f32(x + 4), taps_[k]);
+        }
+        vst1q_f32(out + c, acc0);
+        vst1q_f32(out + c + 4, acc1);
+    }
+    for (; c + 4 <= channels_; c += 4) {
+        float32x4_t acc = vdupq_n_f32(0.0f);
+        const float* x = first + c;
+        for (int k = 0; k < tap_count; ++k, x += stride) {
+            acc = vmlaq_n_f32(acc, vld1q_f32(x), taps_[k]);
+        }
+        vst1q_f32(out + c, acc);
+    }
+#endif
+    // Leftover channels (or no SIMD)
+    for (; c < channels_; ++c) {
+        float acc = 0.0f;
+        for (int k = 0; k < tap_count; ++k) acc += taps_[k] * first[k * stride + c];
+        out[c] = acc;
+    }
+}
+
+size_t Decimator::process(const float* in, size_t frames, float* out) {
+    if (factor_ == 1) {
+        std::memcpy(out, in, frames * channels_ * sizeof(float));
+        return frames;
+    }
+
+    const size_t history = taps_.size() - 1;
+    size_t produced = 0;
+    while (frames > 0) {
+        const size_t n = std::min(frames, BLOCK_FRAMES);
+        std::memcpy(buffer_.data() + buffered_ * channels_, in, n * channels_ * sizeof(float));
+        buffered_ += n;
+        in += n * channels_;
+        frames -= n;
+
+        // Evaluate only the outputs that are kept
+        for (; next_output_ < buffered_; next_output_ += factor_) {
+            filter_frame(buffer_.data() + (next_output_ - history) * channels_, out + produced * channels_);
+            ++produced;
+        }
+
+        // Slide the last taps - 1 frames to the front as history for the next block
+        const size_t shift = buffered_ - history;
+        std::memmove(buffer_.data(), buffer_.data() + shift * channels_, history * channels_ * sizeof(float));
+        buffered_ = history;
+        next_output_ -= shift;
+    }
+    return produced;
+}
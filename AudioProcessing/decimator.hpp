@@ -0,0 +1,54 @@
+// =================================================================================================
+// Polyphase anti-alias decimator for interleaved multi-channel audio
+// =================================================================================================
+//
+// The beamformer only looks at the voice band (up to MAX_FREQ = 3400 Hz), so the 48 kHz capture
+// can be decimated by 3 (16 kHz) or 4 (12 kHz) before framing, shrinking the FFTs, the steering
+// table and the beamformer to match.
+//
+// The low-pass is a linear-phase windowed-sinc FIR with TAPS_PER_PHASE taps per polyphase branch.
+// Only the retained outputs are evaluated, so it costs TAPS_PER_PHASE multiply-adds per input
+// sample and channel. Aliases only have to be kept out of the voice band, so the stopband starts
+// at output_rate - MAX_FREQ rather than at the output Nyquist frequency. From there to the input
+// Nyquist frequency the response stays below -79 dB for factor 3 and -75 dB for factor 4 (whose
+// stopband edge is closer to the cutoff for the filter's length); the 300-3400 Hz passband is
+// flat to within 0.01 dB.
+//
+// Frames stay interleaved: each tap multiplies a contiguous run of channels, which maps directly
+// onto SSE/NEON registers (4 channels per register) when the channel count is a multiple of 4.
+// The delay line is preallocated, so process() never touches the heap and is safe to call from the
+// capture callback. A factor of 1 passes the input through unchanged.
+// =================================================================================================
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+class Decimator {
+public:
+    static const int TAPS_PER_PHASE = 16;
+    static const size_t BLOCK_FRAMES = 1024; // Input frames filtered per pass over the delay line
+
+    Decimator(int channels, int factor);
+
+    int factor() const { return factor_; }
+
+    // Upper bound on the frames process() writes for `input_frames` input frames
+    size_t max_output_frames(size_t input_frames) const { return input_frames / factor_ + 1; }
+
+    // Filters `frames` interleaved input frames and writes the decimated interleaved frames to
+    // `out`, returning how many were written. Output frame m corresponds to input frame m * factor
+    // of the whole stream, delayed by (factor * TAPS_PER_PHASE - 1) / 2 input frames.
+    size_t process(const float* in, size_t frames, float* out);
+
+private:
+    void filter_frame(const float* first, float* out) const;
+
+    int channels_;
+    int factor_;
+    std::vector<float> taps_;    // factor * TAPS_PER_PHASE coefficients (symmetric)
+    std::vector<float> buffer_;  // Delay line: taps - 1 frames of history plus one input block
+    size_t buffered_ = 0;        // Frames currently in buffer_
+    size_t next_output_ = 0;     // buffer_ frame index of the newest input of the next output
+};
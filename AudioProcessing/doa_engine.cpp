@@ -0,0 +1,211 @@
+#define _USE_MATH_DEFINES //added due to math error
+#include "doa_engine.hpp"
+#include "planar_ring.hpp" // window_s16, S16_SCALE
+
+#include <algorithm>
+#include <cmath>
+
+bool make_doa_config(int decimation, DoaConfig& config, std::string& error) {
+    config = DoaConfig();
+    if (decimation == 1) return true;
+    if (decimation != 3 && decimation != 4) {
+        error = "Decimation factor must be 1, 3 or 4";
+        return false;
+    }
+    config.decimation = decimation;
+    config.sample_rate = SAMPLE_RATE / decimation;
+    config.fft_size = 256;
+    config.hop_size = config.fft_size / 2;
+    return true;
+}
+
+std::vector<double> make_analysis_window(const DoaConfig& config) {
+    // Create a Hamming window for better FFT results
+    const int fft_size = config.fft_size;
+    std::vector<double> window(fft_size);
+    for(int i = 0; i < fft_size; i++) {
+        window[i] = 0.54f - 0.46f * cosf(2.0f * M_PI * i / (fft_size - 1));
+    }
+    return window;
+}
+
+std::vector<float> make_s16_analysis_window(const DoaConfig& config) {
+    const std::vector<double> window = make_analysis_window(config);
+    std::vector<float> scaled(window.size());
+    for (size_t i = 0; i < window.size(); ++i) scaled[i] = (float)window[i] * S16_SCALE;
+    return scaled;
+}
+
+// Energy gate and FFTs over the already windowed workspace.channels
+static float transform_windowed(float energy_threshold, StftWorkspace& workspace,
+                                std::vector<ComplexVector>& channel_ffts) {
+    auto& channels = workspace.channels;
+
+    // --- Check energy threshold ---
+    float rms_energy = 0.0f;
+    for (float sample : channels[0]) rms_energy += sample * sample; // Use central mic for energy check
+    rms_energy = std::sqrt(rms_energy / channels[0].size());
+
+    if (rms_energy >= energy_threshold) {
+        // --- Perform FFT on all channels ---
+        for (int i = 0; i < CHANNEL_COUNT; ++i) {
+            // 1. Copy the real-valued channel data into the complex buffer
+            channel_ffts[i].assign(channels[i].begin(), channels[i].end());
+
+            // 2. Perform the in-place FFT using the precomputed twiddle table
+            Fft::transformRadix2(channel_ffts[i], workspace.fft_exp_table);
+        }
+    }
+    return rms_energy;
+}
+
+float stft_frame(const DoaConfig& config, const float* const* spans, const std::vector<double>& window,
+                 float energy_threshold, StftWorkspace& workspace, std::vector<ComplexVector>& channel_ffts) {
+    auto& channels = workspace.channels;
+
+    // --- Window each channel ---
+    for (int j = 0; j < CHANNEL_COUNT; ++j) {
+        const float* span = spans[j];
+        for (int i = 0; i < config.fft_size; ++i) {
+            channels[j][i] = span[i] * window[i];
+        }
+    }
+    return transform_windowed(energy_threshold, workspace, channel_ffts);
+}
+
+float stft_frame(const DoaConfig& config, const int16_t* const* spans, const std::vector<float>& s16_window,
+                 float energy_threshold, StftWorkspace& workspace, std::vector<ComplexVector>& channel_ffts) {
+    for (int j = 0; j < CHANNEL_COUNT; ++j) {
+        window_s16(spans[j], s16_window.data(), workspace.channels[j].data(), config.fft_size);
+    }
+    return transform_windowed(energy_threshold, workspace, channel_ffts);
+}
+
+std::vector<SteeringVector> precompute_steering_vectors(const DoaConfig& config) {
+    const int fft_size = config.fft_size;
+    std::vector<SteeringVector> all_steering_vectors(360);
+
+    for (int angle = 0; angle < 360; ++angle) {
+        all_steering_vectors[angle].resize(CHANNEL_COUNT);
+        // Use double for all calculations
+        double angle_rad = angle * M_PI / 180.0;
+
+        for (int i = 1; i <= 6; ++i) { // Only for the 6 outer mics
+            all_steering_vectors[angle][i].resize(fft_size / 2 + 1);
+            // Ensure MIC_POSITIONS values are treated as double
+            double mic_x = MIC_POSITIONS[i].first;
+            double mic_y = MIC_POSITIONS[i].second;
+
+            // Project mic position onto the sound wave direction vector
+            double projection = mic_x * cos(angle_rad) + mic_y * sin(angle_rad);
+            double time_delay = projection / SPEED_OF_SOUND;
+
+            for (int k = 0; k <= fft_size / 2; ++k) {
+                double freq = (double)k * config.sample_rate / fft_size;
+                double omega = 2.0 * M_PI * freq;
+                // The steering vector is the complex exponential representing the phase shift
+                // This line will now work correctly
+                all_steering_vectors[angle][i][k] = std::exp(Complex(0.0, 1.0) * omega * time_delay);
+            }
+        }
+    }
+    return all_steering_vectors;
+}
+
+// Apply bandpass filter AND amplify voice frequencies
+static void band_limit(std::vector<ComplexVector>& channel_ffts, int min_bin, int max_bin) {
+    for (auto& fft_vec : channel_ffts) {
+        for (size_t k = 0; k < fft_vec.size(); ++k) {
+            if ((int)k >= min_bin && (int)k <= max_bin) {
+                // Apply gain to the frequencies we want
+                fft_vec[k] *= VOICE_FREQ_GAIN;
+            } else {
+                // Zero out all other frequencies
+                fft_vec[k] = 0;
+            }
+        }
+    }
+}
+
+// UPDATED ALGORITHM: Frequency-Domain Beamforming with Voice Amplification
+std::pair<int, double> calculate_doa_fft(
+    const DoaConfig& config,
+    std::vector<ComplexVector>& channel_ffts,
+    const std::vector<SteeringVector>& all_steering_vectors,
+    float* power_map) {
+
+    double max_power = -1.0;
+    int best_angle = -1;
+
+    // Define the frequency bins for our bandpass filter
+    const int min_bin = static_cast<int>(MIN_FREQ * config.fft_size / config.sample_rate);
+    const int max_bin = static_cast<int>(MAX_FREQ * config.fft_size / config.sample_rate);
+    band_limit(channel_ffts, min_bin, max_bin);
+
+    // Sum the steered spectra bin by bin; no per-angle scratch spectrum is needed
+    for (int angle = 0; angle < 360; ++angle) {
+        const SteeringVector& steering = all_steering_vectors[angle];
+        double current_power = 0.0;
+        for (int k = min_bin; k <= max_bin; ++k) {
+            Complex summed_bin(0.0, 0.0);
+            for (int i = 1; i <= 6; ++i) { // Only use the 6 outer mics
+                summed_bin += channel_ffts[i][k] * std::conj(steering[i][k]);
+            }
+            current_power += std::norm(summed_bin);
+        }
+        if (power_map != nullptr) power_map[angle] = (float)current_power;
+
+        if (current_power > max_power) {
+            max_power = current_power;
+            best_angle = angle;
+        }
+    }
+    return {best_angle, max_power};
+}
+
+void calculate_doa_fft_batch(
+    const DoaConfig& config,
+    std::vector<ComplexVector>* const* hop_ffts,
+    int count,
+    const std::vector<SteeringVector>& all_steering_vectors,
+    std::pair<int, double>* results,
+    float* const* power_maps) {
+
+    const int min_bin = static_cast<int>(MIN_FREQ * config.fft_size / config.sample_rate);
+    const int max_bin = static_cast<int>(MAX_FREQ * config.fft_size / config.sample_rate);
+    for (int h = 0; h < count; ++h) band_limit(*hop_ffts[h], min_bin, max_bin);
+
+    for (int first = 0; first < count; first += MAX_DOA_BATCH) {
+        const int batch = std::min(MAX_DOA_BATCH, count - first);
+        std::pair<int, double>* batch_results = results + first;
+        float* const* batch_maps = power_maps != nullptr ? power_maps + first : nullptr;
+        for (int h = 0; h < batch; ++h) batch_results[h] = {-1, -1.0};
+
+        double power[MAX_DOA_BATCH];
+        for (int angle = 0; angle < 360; ++angle) {
+            // This angle's steering vectors (a few KB over the voice band) stay in L1 for every hop
+            const SteeringVector& steering = all_steering_vectors[angle];
+            for (int h = 0; h < batch; ++h) {
+                const std::vector<ComplexVector>& ffts = *hop_ffts[first + h];
+                double current_power = 0.0;
+                for (int k = min_bin; k <= max_bin; ++k) {
+                    // x * conj(w) written out: std::complex multiplication adds inf/NaN recovery
+                    // checks that keep this loop from vectorizing
+                    double re = 0.0, im = 0.0;
+                    for (int i = 1; i <= 6; ++i) {
+                        const Complex x = ffts[i][k];
+                        const Complex w = steering[i][k];
+                        re += x.real() * w.real() + x.imag() * w.imag();
+                        im += x.imag() * w.real() - x.real() * w.imag();
+                    }
+                    current_power += re * re + im * im;
+                }
+                power[h] = current_power;
+                if (batch_maps != nullptr && batch_maps[h] != nullptr) batch_maps[h][angle] = (float)current_power;
+            }
+            for (int h = 0; h < batch; ++h) {
+                if (power[h] > batch_results[h].second) batch_results[h] = {angle, power[h]};
+            }
+        }
+    }
+}
@@ -0,0 +1,107 @@
+// =================================================================================================
+// Frequency-domain beamforming DOA engine for the UMA-8 array
+// =================================================================================================
+//
+// The per-hop analysis shared by tdoa_realtime and tdoa_bench: a Hamming window over one frame
+// of every channel, an energy gate on the centre mic, one FFT per channel, then a
+// delay-and-sum scan over 360 one-degree steering vectors restricted to the voice band.
+// Keeping it in one place means the benchmark always measures exactly what the real-time
+// pipeline runs.
+//
+// The engine runs either at the capture rate or on a decimated stream (see decimator.hpp). A
+// DoaConfig carries the rate and frame sizes in use; every function below takes one.
+// =================================================================================================
+
+#pragma once
+
+#include "fft.hpp"
+#include "uma8_geometry.hpp" // SAMPLE_RATE, CHANNEL_COUNT, MIC_POSITIONS
+
+#include <complex>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// --- TDOA Processing Configuration ---
+const int FFT_SIZE = 1024;         // At the full capture rate
+const int HOP_SIZE = FFT_SIZE / 2;
+const float ENERGY_THRESHOLD = 0.001f; // Adjust based on sensitivity needs
+const double VOICE_FREQ_GAIN = 3.0; // Boosts voice frequencies by 3x
+const int MAX_DOA_BATCH = 8;       // Hops scored per pass over the steering table
+
+// --- Bandpass Filter Configuration for Human Voice ---
+const float MIN_FREQ = 300.0f;  // Minimum frequency for human voice
+const float MAX_FREQ = 3400.0f; // Maximum frequency for human voice
+
+// --- Type definitions for clarity ---
+using Complex = std::complex<double>;
+using ComplexVector = std::vector<Complex>;
+using SteeringVector = std::vector<ComplexVector>; // [mic_index][freq_bin]
+
+// Rate and frame sizes the engine runs at. The defaults process the capture at full rate.
+struct DoaConfig {
+    int decimation = 1;          // Capture samples per engine sample
+    int sample_rate = SAMPLE_RATE;
+    int fft_size = FFT_SIZE;
+    int hop_size = HOP_SIZE;
+};
+
+// Builds the config for a capture decimated by 1, 3 or 4. The FFT keeps roughly the frame length
+// of FFT_SIZE at 48 kHz in the nearest power of two: 256 points at 12 kHz (the same 46.9 Hz bins)
+// and 256 points at 16 kHz (62.5 Hz bins). Returns false and fills `error` for other factors.
+bool make_doa_config(int decimation, DoaConfig& config, std::string& error);
+
+// Scratch buffers owned by whoever runs the STFT, allocated once so the steady-state loop never
+// touches the heap
+struct StftWorkspace {
+    std::vector<std::vector<float>> channels; // [mic][sample], windowed
+    ComplexVector fft_exp_table;              // FFT twiddle factors for fft_size
+
+    explicit StftWorkspace(const DoaConfig& config)
+        : channels(CHANNEL_COUNT, std::vector<float>(config.fft_size)),
+          fft_exp_table(Fft::makeExpTable(config.fft_size)) {}
+};
+
+// Hamming window of config.fft_size points
+std::vector<double> make_analysis_window(const DoaConfig& config);
+
+// The same window in float, pre-scaled by S16_SCALE, for the 16-bit stft_frame below
+std::vector<float> make_s16_analysis_window(const DoaConfig& config);
+
+// Windows config.fft_size samples from spans[mic] for every channel and returns the RMS of the
+// windowed centre mic. Only if it reaches energy_threshold (ENERGY_THRESHOLD, or 0 once a VAD has
+// already judged the hop) are the channels transformed into channel_ffts[mic] (each
+// config.fft_size bins); otherwise channel_ffts is left untouched.
+float stft_frame(const DoaConfig& config, const float* const* spans, const std::vector<double>& window,
+                 float energy_threshold, StftWorkspace& workspace, std::vector<ComplexVector>& channel_ffts);
+
+// 16-bit capture path: the int16 -> float conversion is fused into the windowing pass (SIMD, see
+// window_s16), with s16_window from make_s16_analysis_window. Results match the float overload
+// on the same samples scaled to [-1, 1).
+float stft_frame(const DoaConfig& config, const int16_t* const* spans, const std::vector<float>& s16_window,
+                 float energy_threshold, StftWorkspace& workspace, std::vector<ComplexVector>& channel_ffts);
+
+// Pre-computes the phase shifts for all angles, mics, and frequencies
+std::vector<SteeringVector> precompute_steering_vectors(const DoaConfig& config);
+
+// Band-limits channel_ffts in place and returns the best angle (degrees) and its beam power.
+// If power_map is given, it receives the beam power at every angle (360 floats).
+std::pair<int, double> calculate_doa_fft(
+    const DoaConfig& config,
+    std::vector<ComplexVector>& channel_ffts,
+    const std::vector<SteeringVector>& all_steering_vectors,
+    float* power_map = nullptr);
+
+// Beamforms `count` hops together: band-limits each hop's FFTs (*hop_ffts[h]) in place, then walks
+// the steering table once per MAX_DOA_BATCH hops, scoring all of them against each steering vector
+// while it is in cache. results[h] is what calculate_doa_fft returns for hop h. Used to catch up
+// on a backlog, where the table (megabytes at the full rate) would otherwise stream from memory
+// once per hop. power_maps, if given, holds one 360-float map per hop (entries may be null).
+void calculate_doa_fft_batch(
+    const DoaConfig& config,
+    std::vector<ComplexVector>* const* hop_ffts,
+    int count,
+    const std::vector<SteeringVector>& all_steering_vectors,
+    std::pair<int, double>* results,
+    float* const* power_maps = nullptr);
@@ -0,0 +1,259 @@
+#include "doa_shm.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #include <cerrno>
+#endif
+
+static_assert(sizeof(DoaShmSlot) % 64 == 0, "slots must not share cache lines");
+static_assert(sizeof(DoaShmHeader) <= sizeof(DoaShmSlot), "the header occupies the first slot-sized block");
+
+void find_power_map_peaks(DoaShmRecord& record) {
+    record.peak_count = 0;
+    const float* map = record.power_map;
+    for (int angle = 0; angle < DOA_SHM_ANGLES; ++angle) {
+        const float power = map[angle];
+        const float before = map[(angle + DOA_SHM_ANGLES - 1) % DOA_SHM_ANGLES];
+        const float after = map[(angle + 1) % DOA_SHM_ANGLES];
+        // Strict on one side so a flat top counts once
+        if (power <= 0.0f || power <= before || power < after) continue;
+
+        // Insert into the strongest-first list, dropping the weakest if it is full
+        int slot = record.peak_count;
+        while (slot > 0 && record.peak_powers[slot - 1] < power) --slot;
+        if (slot >= DOA_SHM_MAX_PEAKS) continue;
+        const int last = std::min<int>(record.peak_count, DOA_SHM_MAX_PEAKS - 1);
+        for (int i = last; i > slot; --i) {
+            record.peak_angles[i] = record.peak_angles[i - 1];
+            record.peak_powers[i] = record.peak_powers[i - 1];
+        }
+        record.peak_angles[slot] = (int16_t)angle;
+        record.peak_powers[slot] = power;
+        if (record.peak_count < DOA_SHM_MAX_PEAKS) ++record.peak_count;
+    }
+}
+
+static size_t mapping_bytes(uint32_t slot_count) {
+    // The header takes one slot-sized block so the slots stay aligned
+    return sizeof(DoaShmSlot) * (1 + (size_t)slot_count);
+}
+
+// --- Platform mapping: POSIX shared memory, or a pagefile-backed named mapping on Windows ---
+#if !defined(_WIN32)
+
+// Creates the object `name` of `bytes` bytes and maps it read-write. `handle` is unused here.
+static void* create_shared_mapping(const std::string& name, size_t bytes, void*& handle, std::string& error) {
+    handle = nullptr;
+    // A previous run that was killed leaves its object behind; start from a fresh one so readers
+    // still mapping the old object are not mixed with the new stream
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        error = "shm_open(" + name + ") failed: " + std::strerror(errno);
+        return nullptr;
+    }
+    if (ftruncate(fd, (off_t)bytes) != 0) {
+        error = "could not size " + name + ": " + std::strerror(errno);
+        ::close(fd);
+        shm_unlink(name.c_str());
+        return nullptr;
+    }
+    void* mapping = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        error = "could not map " + name + ": " + std::strerror(errno);
+        shm_unlink(name.c_str());
+        return nullptr;
+    }
+    return mapping;
+}
+
+// Removes the name; processes that have the object mapped keep their view
+static void remove_shared_mapping(const std::string& name, void*& handle) {
+    shm_unlink(name.c_str());
+    handle = nullptr;
+}
+
+// Maps an existing object read-only and returns its size in `bytes`
+static const void* open_shared_mapping(const std::string& name, size_t& bytes, std::string& error) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        error = "shm_open(" + name + ") failed: " + std::strerror(errno) + " (is tdoa_realtime running with --shm?)";
+        return nullptr;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(DoaShmSlot)) {
+        error = name + " is not a DOA result ring";
+        ::close(fd);
+        return nullptr;
+    }
+    bytes = (size_t)info.st_size;
+    void* mapping = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        error = "could not map " + name + ": " + std::strerror(errno);
+        return nullptr;
+    }
+    return mapping;
+}
+
+static void unmap_shared(const void* mapping, size_t bytes) { munmap(const_cast<void*>(mapping), bytes); }
+
+#else
+
+// A named mapping exists while some process holds a handle to it, so the writer keeps `handle`
+// open until close(); a killed publisher leaves nothing behind.
+static void* create_shared_mapping(const std::string& name, size_t bytes, void*& handle, std::string& error) {
+    handle = nullptr;
+    HANDLE section = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, (DWORD)((uint64_t)bytes >> 32),
+                                        (DWORD)(bytes & 0xFFFFFFFFu), name.c_str());
+    if (section == nullptr) {
+        error = "CreateFileMapping(" + name + ") failed (error " + std::to_string(GetLastError()) + ")";
+        return nullptr;
+    }
+    if (GetLastError() == ERROR_ALREADY_EXISTS) {
+        // Reusing it would mix the new stream with the old one in front of its readers
+        CloseHandle(section);
+        error = name + " is still open in another process (a running publisher or reader)";
+        return nullptr;
+    }
+    void* mapping = MapViewOfFile(section, FILE_MAP_ALL_ACCESS, 0, 0, bytes);
+    if (mapping == nullptr) {
+        error = "could not map " + name + " (error " + std::to_string(GetLastError()) + ")";
+        CloseHandle(section);
+        return nullptr;
+    }
+    handle = section;
+    return mapping;
+}
+
+static void remove_shared_mapping(const std::string& name, void*& handle) {
+    (void)name;
+    if (handle != nullptr) CloseHandle(handle);
+    handle = nullptr;
+}
+
+static const void* open_shared_mapping(const std::string& name, size_t& bytes, std::string& error) {
+    HANDLE section = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+    if (section == nullptr) {
+        error = "OpenFileMapping(" + name + ") failed (error " + std::to_string(GetLastError()) +
+                ") (is tdoa_realtime running with --shm?)";
+        return nullptr;
+    }
+    const void* mapping = MapViewOfFile(section, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(section); // The view keeps the mapping alive
+    if (mapping == nullptr) {
+        error = "could not map " + name + " (error " + std::to_string(GetLastError()) + ")";
+        return nullptr;
+    }
+    MEMORY_BASIC_INFORMATION info;
+    if (VirtualQuery(mapping, &info, sizeof(info)) == 0 || info.RegionSize < sizeof(DoaShmSlot)) {
+        error = name + " is not a DOA result ring";
+        UnmapViewOfFile(mapping);
+        return nullptr;
+    }
+    bytes = info.RegionSize; // Whole pages; the header's slot count gives the ring's real extent
+    return mapping;
+}
+
+static void unmap_shared(const void* mapping, size_t bytes) {
+    (void)bytes;
+    UnmapViewOfFile(mapping);
+}
+
+#endif
+
+bool DoaShmWriter::open(const std::string& name, const DoaConfig& config, std::string& error) {
+    close();
+
+    const size_t bytes = mapping_bytes(DOA_SHM_SLOTS);
+    void* mapping = create_shared_mapping(name, bytes, handle_, error);
+    if (mapping == nullptr) return false;
+
+    // Constructing every slot also faults the whole mapping in before the first publish
+    header_ = new (mapping) DoaShmHeader();
+    slots_ = reinterpret_cast<DoaShmSlot*>(static_cast<char*>(mapping) + sizeof(DoaShmSlot));
+    for (int i = 0; i < DOA_SHM_SLOTS; ++i) new (&slots_[i]) DoaShmSlot();
+
+    header_->version = DOA_SHM_VERSION;
+    header_->slot_count = DOA_SHM_SLOTS;
+    header_->record_size = sizeof(DoaShmRecord);
+    header_->sample_rate = config.sample_rate;
+    header_->hop_size = config.hop_size;
+    header_->fft_size = config.fft_size;
+    header_->writer_closed.store(0, std::memory_order_relaxed);
+    header_->published.store(0, std::memory_order_relaxed);
+    header_->magic.store(DOA_SHM_MAGIC, std::memory_order_release); // Readers accept the ring from here on
+
+    name_ = name;
+    mapping_ = mapping;
+    bytes_ = bytes;
+    next_ = 0;
+    return true;
+}
+
+void DoaShmWriter::close() {
+    if (header_ == nullptr) return;
+    header_->writer_closed.store(1, std::memory_order_release);
+    unmap_shared(mapping_, bytes_);
+    remove_shared_mapping(name_, handle_);
+    header_ = nullptr;
+    slots_ = nullptr;
+    mapping_ = nullptr;
+}
+
+void DoaShmWriter::publish(const DoaShmRecord& record) {
+    const uint64_t n = next_++;
+    DoaShmSlot& slot = slots_[n % DOA_SHM_SLOTS];
+    slot.sequence.store(2 * n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release); // Odd sequence is visible before any new bytes
+    std::memcpy(&slot.record, &record, sizeof(DoaShmRecord));
+    slot.sequence.store(2 * n + 2, std::memory_order_release);
+    header_->published.store(n + 1, std::memory_order_release);
+}
+
+bool DoaShmReader::open(const std::string& name, std::string& error) {
+    close();
+
+    size_t bytes = 0;
+    const void* mapping = open_shared_mapping(name, bytes, error);
+    if (mapping == nullptr) return false;
+
+    const DoaShmHeader* header = static_cast<const DoaShmHeader*>(mapping);
+    std::string problem;
+    if (header->magic.load(std::memory_order_acquire) != DOA_SHM_MAGIC) {
+        problem = name + " is not initialized yet";
+    } else if (header->version != DOA_SHM_VERSION || header->record_size != sizeof(DoaShmRecord)) {
+        problem = name + " was written by an incompatible version (format " + std::to_string(header->version) + ")";
+    } else if (header->slot_count == 0 || mapping_bytes(header->slot_count) > bytes) {
+        problem = name + " is truncated";
+    }
+    if (!problem.empty()) {
+        error = problem;
+        unmap_shared(mapping, bytes);
+        return false;
+    }
+
+    mapping_ = mapping;
+    bytes_ = bytes;
+    header_ = header;
+    slots_ = reinterpret_cast<const DoaShmSlot*>(static_cast<const char*>(mapping) + sizeof(DoaShmSlot));
+    return true;
+}
+
+void DoaShmReader::close() {
+    if (header_ == nullptr) return;
+    unmap_shared(mapping_, bytes_);
+    header_ = nullptr;
+    slots_ = nullptr;
+    mapping_ = nullptr;
+}
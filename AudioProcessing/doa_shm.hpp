@@ -0,0 +1,147 @@
+// =================================================================================================
+// Shared-memory ring of DOA results for local consumer processes
+// =================================================================================================
+//
+// tdoa_realtime --shm NAME publishes every hop's result into a shared-memory object (POSIX
+// shm_open on Linux/macOS, a named CreateFileMapping section on Windows): a header describing the
+// stream, followed by DOA_SHM_SLOTS fixed-size slots used as a ring.
+// Record n (counting from 0) lives in slot n % DOA_SHM_SLOTS, so consumers can read the latest
+// result or go back through up to DOA_SHM_SLOTS of history.
+//
+// Each slot is a sequence lock: the writer marks it odd (2n + 1) while writing record n and even
+// (2n + 2) when it is complete. A reader checks the sequence before and after looking at a record
+// in place; a mismatch means the writer lapped it mid-read and the read is simply retried or
+// skipped. Readers never write to the mapping, never wait for the writer and make no syscalls once
+// the object is mapped, so any number of them can follow the stream without slowing it down.
+//
+// Timestamps use the steady clock (CLOCK_MONOTONIC on Linux, QueryPerformanceCounter on Windows,
+// shared by every process) plus the same instant on the system clock for logging.
+// =================================================================================================
+
+#pragma once
+
+#include "doa_engine.hpp" // DoaConfig
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+const char* const DOA_SHM_DEFAULT_NAME = "/uma8_doa";
+const uint32_t DOA_SHM_MAGIC = 0x55444f41; // "UDOA"
+const uint32_t DOA_SHM_VERSION = 1;
+const int DOA_SHM_SLOTS = 1024;    // About 11 s of history at 48 kHz / 512-sample hops
+const int DOA_SHM_ANGLES = 360;    // One power map entry per degree
+const int DOA_SHM_MAX_PEAKS = 4;
+
+// One hop's result, exactly as stored in shared memory
+struct DoaShmRecord {
+    uint64_t hop;                            // Hop sequence number
+    int64_t capture_ns;                      // Steady clock time the hop's last block arrived
+    int64_t capture_unix_ns;                 // The same instant on the system clock
+    double audio_time_s;                     // Start of the hop's frame on the audio timeline
+    float rms_energy;
+    float noise_floor;                       // VAD noise floor (RMS); 0 with --vad fixed
+    uint8_t active;                          // VAD state: 1 if the beamformer ran on this hop
+    uint8_t peak_count;                      // Valid entries in peak_angles / peak_powers
+    uint16_t reserved;
+    int16_t peak_angles[DOA_SHM_MAX_PEAKS];  // Local maxima of power_map in degrees, strongest first
+    float peak_powers[DOA_SHM_MAX_PEAKS];
+    float power_map[DOA_SHM_ANGLES];         // Beam power per degree; all zero on silent hops
+};
+
+struct DoaShmHeader {
+    std::atomic<uint32_t> magic;             // DOA_SHM_MAGIC once the writer has initialized the ring
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t record_size;                    // sizeof(DoaShmRecord), as a layout check
+    int32_t sample_rate;                     // Rate and frame sizes the DOA engine runs at
+    int32_t hop_size;
+    int32_t fft_size;
+    std::atomic<uint32_t> writer_closed;     // Set when the publisher exits
+    alignas(64) std::atomic<uint64_t> published; // Records written so far; the latest is published - 1
+};
+
+struct alignas(64) DoaShmSlot {
+    std::atomic<uint64_t> sequence;          // 2n + 1 while record n is written, 2n + 2 once complete
+    DoaShmRecord record;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared-memory seqlock needs lock-free 64-bit atomics");
+
+// Fills peak_count, peak_angles and peak_powers from record.power_map
+void find_power_map_peaks(DoaShmRecord& record);
+
+// Creates (or replaces) the shared-memory object and publishes records into it. Single writer.
+class DoaShmWriter {
+public:
+    DoaShmWriter() = default;
+    DoaShmWriter(const DoaShmWriter&) = delete;
+    DoaShmWriter& operator=(const DoaShmWriter&) = delete;
+    ~DoaShmWriter() { close(); }
+
+    // `name` is a shared-memory name such as "/uma8_doa" (on Windows, any name without a
+    // backslash, or with a Local\ / Global\ prefix). Returns false and fills `error`.
+    bool open(const std::string& name, const DoaConfig& config, std::string& error);
+
+    // Marks the stream closed and removes the name; readers that have it mapped keep their view.
+    // On Windows the name lasts until the last reader closes too, and open() refuses to reuse it.
+    void close();
+
+    bool is_open() const { return header_ != nullptr; }
+
+    // Copies one record into the next slot. Never blocks.
+    void publish(const DoaShmRecord& record);
+
+private:
+    std::string name_;
+    void* mapping_ = nullptr;
+    size_t bytes_ = 0;
+    DoaShmHeader* header_ = nullptr;
+    DoaShmSlot* slots_ = nullptr;
+    void* handle_ = nullptr;           // Windows: the mapping, which exists while a handle is open
+    uint64_t next_ = 0;
+};
+
+// Maps an existing object read-only
+class DoaShmReader {
+public:
+    DoaShmReader() = default;
+    DoaShmReader(const DoaShmReader&) = delete;
+    DoaShmReader& operator=(const DoaShmReader&) = delete;
+    ~DoaShmReader() { close(); }
+
+    // Fails if the object does not exist yet or was written by an incompatible version
+    bool open(const std::string& name, std::string& error);
+    void close();
+
+    const DoaShmHeader& header() const { return *header_; }
+
+    // Records published so far; records published() - slot_count .. published() - 1 are readable
+    uint64_t published() const { return header_->published.load(std::memory_order_acquire); }
+    bool writer_closed() const { return header_->writer_closed.load(std::memory_order_acquire) != 0; }
+
+    // Calls visitor(const DoaShmRecord&) on record n in place, without copying it. Returns false if
+    // record n is not in the ring (not yet written, or already overwritten) or was overwritten
+    // while the visitor ran; anything the visitor derived from it must then be discarded.
+    template <typename Visitor>
+    bool visit(uint64_t n, Visitor&& visitor) const {
+        const DoaShmSlot& slot = slots_[n % header_->slot_count];
+        const uint64_t complete = 2 * n + 2;
+        if (slot.sequence.load(std::memory_order_acquire) != complete) return false;
+        visitor(slot.record);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot.sequence.load(std::memory_order_relaxed) == complete;
+    }
+
+    // Copies record n into `out`; same return value as visit()
+    bool read(uint64_t n, DoaShmRecord& out) const {
+        return visit(n, [&](const DoaShmRecord& record) { out = record; });
+    }
+
+private:
+    const void* mapping_ = nullptr;
+    size_t bytes_ = 0;
+    const DoaShmHeader* header_ = nullptr;
+    const DoaShmSlot* slots_ = nullptr;
+};
@@ -40,11 +40,27 @@
          levels++;
      if (static_cast<size_t>(1U) << levels != n)
          throw std::domain_error("Length is not a power of 2");
-     
+     transformRadix2(vec, makeExpTable(n));
+ }
+ 
+ 
+ vector<complex<double>> Fft::makeExpTable(size_t n) {
      // Trignometric tables
      vector<complex<double>> expTable(n / 2);
      for (size_t i = 0; i < n / 2; i++)
          expTable[i] = std::exp(complex<double>(0, -2 * M_PI * i / n));
+     return expTable;
+ }
+ 
+ 
+ void Fft::transformRadix2(vector<complex<double>> &vec, const vector<complex<double>> &expTable) {
+     // Length variables
+     size_t n = vec.size();
+     int levels = 0;
+     for (size_t temp = n; temp > 1U; temp >>= 1)
+         levels++;
+     if (static_cast<size_t>(1U) << levels != n || expTable.size() != n / 2)
+         throw std::domain_error("Length is not a power of 2 or does not match the table");
      
      // Bit-reversed addressing permutation
      for (size_t i = 0; i < n; i++) {
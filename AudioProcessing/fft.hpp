@@ -25,5 +25,14 @@
       * The vector's length must be a power of 2. Uses the Cooley-Tukey decimation-in-time radix-2 algorithm.
       */
      void transformRadix2(std::vector<std::complex<double>> &vec);
+ 
+     /* * Precomputes the trigonometric table used by the radix-2 transform of length n (a power of 2).
+      */
+     std::vector<std::complex<double>> makeExpTable(std::size_t n);
+ 
+     /* * Same as transformRadix2(vec), but uses a table from makeExpTable(vec.size()) instead of
+      * building one, so the transform itself performs no memory allocation.
+      */
+     void transformRadix2(std::vector<std::complex<double>> &vec, const std::vector<std::complex<double>> &expTable);
  }
  
\ No newline at end of file
@@ -0,0 +1,48 @@
+#include "latency_histogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+int LatencyHistogram::bucket_index(uint64_t value) {
+    if (value < (uint64_t)SUB_BUCKETS) return (int)value;
+    int msb = 63;
+    while (!(value >> msb)) --msb;
+    int shift = msb - SUB_BUCKET_BITS;
+    int magnitude = shift + 1;
+    int sub = (int)((value >> shift) & (SUB_BUCKETS - 1));
+    return std::min(magnitude * SUB_BUCKETS + sub, BUCKET_COUNT - 1);
+}
+
+int64_t LatencyHistogram::bucket_upper_bound(int index) {
+    if (index < SUB_BUCKETS) return index;
+    int magnitude = index / SUB_BUCKETS;
+    int sub = index % SUB_BUCKETS;
+    int shift = magnitude - 1;
+    return ((int64_t)(SUB_BUCKETS + sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(int64_t nanoseconds) {
+    if (nanoseconds < 0) nanoseconds = 0;
+    buckets_[bucket_index((uint64_t)nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+
+    int64_t current = max_.load(std::memory_order_relaxed);
+    while (nanoseconds > current &&
+           !max_.compare_exchange_weak(current, nanoseconds, std::memory_order_relaxed)) {
+    }
+}
+
+int64_t LatencyHistogram::percentile(double percentile) const {
+    uint64_t total = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i) total += buckets_[i].load(std::memory_order_relaxed);
+    if (total == 0) return 0;
+
+    uint64_t target = (uint64_t)std::ceil(total * std::min(std::max(percentile, 0.0), 100.0) / 100.0);
+    target = std::max<uint64_t>(target, 1);
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen >= target) return std::min(bucket_upper_bound(i), max());
+    }
+    return max();
+}
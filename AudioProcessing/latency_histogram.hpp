@@ -0,0 +1,39 @@
+// =================================================================================================
+// Lock-free log-linear latency histogram (HDR-style)
+// =================================================================================================
+//
+// Values are nanoseconds. Each power-of-two range is split into SUB_BUCKETS linear buckets, so any
+// recorded value is reported to within 1/SUB_BUCKETS (~6%) of its true value, from 1 ns up to
+// about 18 minutes. Recording is a couple of relaxed atomic increments, safe from any thread, and
+// never allocates. Percentile queries may run concurrently with recording.
+// =================================================================================================
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+class LatencyHistogram {
+public:
+    static const int SUB_BUCKET_BITS = 4;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const int MAGNITUDES = 40 - SUB_BUCKET_BITS; // Up to 2^40 ns
+    static const int BUCKET_COUNT = (MAGNITUDES + 1) * SUB_BUCKETS;
+
+    void record(int64_t nanoseconds);
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    int64_t max() const { return max_.load(std::memory_order_relaxed); }
+
+    // Value (ns) at or below which `percentile` percent of recordings fall; 0 if empty.
+    int64_t percentile(double percentile) const;
+
+private:
+    static int bucket_index(uint64_t value);
+    static int64_t bucket_upper_bound(int index);
+
+    std::atomic<uint64_t> buckets_[BUCKET_COUNT] = {};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<int64_t> max_{0};
+};
@@ -0,0 +1,251 @@
+#include "planar_ring.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define PLANAR_RING_SSE 1
+    #define PLANAR_RING_SSE2 1
+#elif defined(__SSE__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    #include <xmmintrin.h>
+    #define PLANAR_RING_SSE 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define PLANAR_RING_NEON 1
+#endif
+
+// Transposes a 4 frame x 4 channel tile: reads 4 rows of `stride` floats starting at `in`
+// and writes 4 contiguous samples into each of out[0..3] starting at `pos`.
+static inline void transpose_tile_4x4(const float* in, size_t stride, float* const* out, size_t pos) {
+#if defined(PLANAR_RING_SSE)
+    __m128 r0 = _mm_loadu_ps(in);
+    __m128 r1 = _mm_loadu_ps(in + stride);
+    __m128 r2 = _mm_loadu_ps(in + 2 * stride);
+    __m128 r3 = _mm_loadu_ps(in + 3 * stride);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    _mm_storeu_ps(out[0] + pos, r0);
+    _mm_storeu_ps(out[1] + pos, r1);
+    _mm_storeu_ps(out[2] + pos, r2);
+    _mm_storeu_ps(out[3] + pos, r3);
+#elif defined(PLANAR_RING_NEON)
+    float32x4x2_t t01 = vtrnq_f32(vld1q_f32(in), vld1q_f32(in + stride));
+    float32x4x2_t t23 = vtrnq_f32(vld1q_f32(in + 2 * stride), vld1q_f32(in + 3 * stride));
+    vst1q_f32(out[0] + pos, vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0])));
+    vst1q_f32(out[1] + pos, vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1])));
+    vst1q_f32(out[2] + pos, vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0])));
+    vst1q_f32(out[3] + pos, vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1])));
+#else
+    for (int r = 0; r < 4; ++r)
+        for (int c = 0; c < 4; ++c)
+            out[c][pos + r] = in[r * stride + c];
+#endif
+}
+
+void deinterleave_f32(const float* in, float* const* out, int channels, size_t frames) {
+    size_t i = 0;
+    if (channels % 4 == 0) {
+        for (; i + 4 <= frames; i += 4) {
+            const float* tile = in + i * channels;
+            for (int c = 0; c < channels; c += 4) {
+                transpose_tile_4x4(tile + c, channels, out + c, i);
+            }
+        }
+    }
+    // Leftover frames (or odd channel counts)
+    for (; i < frames; ++i) {
+        for (int c = 0; c < channels; ++c) {
+            out[c][i] = in[i * channels + c];
+        }
+    }
+}
+
+// Transposes an 8 frame x 8 channel tile of 16-bit samples: reads 8 rows of `stride` samples
+// starting at `in` and writes 8 contiguous samples into each of out[0..7] starting at `pos`.
+static inline void transpose_tile_8x8_s16(const int16_t* in, size_t stride, int16_t* const* out, size_t pos) {
+#if defined(PLANAR_RING_SSE2)
+    __m128i r[8];
+    for (int k = 0; k < 8; ++k) r[k] = _mm_loadu_si128((const __m128i*)(in + k * stride));
+    // Interleave pairs of rows, then pairs of pairs, then halves
+    const __m128i a0 = _mm_unpacklo_epi16(r[0], r[1]), a4 = _mm_unpackhi_epi16(r[0], r[1]);
+    const __m128i a1 = _mm_unpacklo_epi16(r[2], r[3]), a5 = _mm_unpackhi_epi16(r[2], r[3]);
+    const __m128i a2 = _mm_unpacklo_epi16(r[4], r[5]), a6 = _mm_unpackhi_epi16(r[4], r[5]);
+    const __m128i a3 = _mm_unpacklo_epi16(r[6], r[7]), a7 = _mm_unpackhi_epi16(r[6], r[7]);
+    const __m128i b0 = _mm_unpacklo_epi32(a0, a1), b2 = _mm_unpackhi_epi32(a0, a1);
+    const __m128i b1 = _mm_unpacklo_epi32(a2, a3), b3 = _mm_unpackhi_epi32(a2, a3);
+    const __m128i b4 = _mm_unpacklo_epi32(a4, a5), b6 = _mm_unpackhi_epi32(a4, a5);
+    const __m128i b5 = _mm_unpacklo_epi32(a6, a7), b7 = _mm_unpackhi_epi32(a6, a7);
+    _mm_storeu_si128((__m128i*)(out[0] + pos), _mm_unpacklo_epi64(b0, b1));
+    _mm_storeu_si128((__m128i*)(out[1] + pos), _mm_unpackhi_epi64(b0, b1));
+    _mm_storeu_si128((__m128i*)(out[2] + pos), _mm_unpacklo_epi64(b2, b3));
+    _mm_storeu_si128((__m128i*)(out[3] + pos), _mm_unpackhi_epi64(b2, b3));
+    _mm_storeu_si128((__m128i*)(out[4] + pos), _mm_unpacklo_epi64(b4, b5));
+    _mm_storeu_si128((__m128i*)(out[5] + pos), _mm_unpackhi_epi64(b4, b5));
+    _mm_storeu_si128((__m128i*)(out[6] + pos), _mm_unpacklo_epi64(b6, b7));
+    _mm_storeu_si128((__m128i*)(out[7] + pos), _mm_unpackhi_epi64(b6, b7));
+#elif defined(PLANAR_RING_NEON)
+    int16x8_t r[8];
+    for (int k = 0; k < 8; ++k) r[k] = vld1q_s16(in + k * stride);
+    const int16x8x2_t b0 = vtrnq_s16(r[0], r[1]);
+    const int16x8x2_t b1 = vtrnq_s16(r[2], r[3]);
+    const int16x8x2_t b2 = vtrnq_s16(r[4], r[5]);
+    const int16x8x2_t b3 = vtrnq_s16(r[6], r[7]);
+    const int32x4x2_t c0 = vtrnq_s32(vreinterpretq_s32_s16(b0.val[0]), vreinterpretq_s32_s16(b1.val[0]));
+    const int32x4x2_t c1 = vtrnq_s32(vreinterpretq_s32_s16(b0.val[1]), vreinterpretq_s32_s16(b1.val[1]));
+    const int32x4x2_t c2 = vtrnq_s32(vreinterpretq_s32_s16(b2.val[0]), vreinterpretq_s32_s16(b3.val[0]));
+    const int32x4x2_t c3 = vtrnq_s32(vreinterpretq_s32_s16(b2.val[1]), vreinterpretq_s32_s16(b3.val[1]));
+    vst1q_s16(out[0] + pos, vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(c0.val[0]), vget_low_s32(c2.val[0]))));
+    vst1q_s16(out[1] + pos, vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(c1.val[0]), vget_low_s32(c3.val[0]))));
+    vst1q_s16(out[2] + pos, vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(c0.val[1]), vget_low_s32(c2.val[1]))));
+    vst1q_s16(out[3] + pos, vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(c1.val[1]), vget_low_s32(c3.val[1]))));
+    vst1q_s16(out[4] + pos, vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(c0.val[0]), vget_high_s32(c2.val[0]))));
+    vst1q_s16(out[5] + pos, vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(c1.val[0]), vget_high_s32(c3.val[0]))));
+    vst1q_s16(out[6] + pos, vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(c0.val[1]), vget_high_s32(c2.val[1]))));
+    vst1q_s16(out[7] + pos, vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(c1.val[1]), vget_high_s32(c3.val[1]))));
+#else
+    for (int r = 0; r < 8; ++r)
+        for (int c = 0; c < 8; ++c)
+            out[c][pos + r] = in[r * stride + c];
+#endif
+}
+
+void deinterleave_s16(const int16_t* in, int16_t* const* out, int channels, size_t frames) {
+    size_t i = 0;
+    if (channels % 8 == 0) {
+        for (; i + 8 <= frames; i += 8) {
+            const int16_t* tile = in + i * channels;
+            for (int c = 0; c < channels; c += 8) {
+                transpose_tile_8x8_s16(tile + c, channels, out + c, i);
+            }
+        }
+    }
+    // Leftover frames (or other channel counts)
+    for (; i < frames; ++i) {
+        for (int c = 0; c < channels; ++c) {
+            out[c][i] = in[i * channels + c];
+        }
+    }
+}
+
+void convert_s16_to_f32(const int16_t* in, float* out, size_t count) {
+    size_t i = 0;
+#if defined(PLANAR_RING_SSE2)
+    const __m128 scale = _mm_set1_ps(S16_SCALE);
+    for (; i + 8 <= count; i += 8) {
+        const __m128i x = _mm_loadu_si128((const __m128i*)(in + i));
+        // Sign-extend by placing each sample in the top half of a 32-bit lane and shifting down
+        const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+        const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+#elif defined(PLANAR_RING_NEON)
+    for (; i + 8 <= count; i += 8) {
+        const int16x8_t x = vld1q_s16(in + i);
+        vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))), S16_SCALE));
+        vst1q_f32(out + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))), S16_SCALE));
+    }
+#endif
+    for (; i < count; ++i) out[i] = in[i] * S16_SCALE;
+}
+
+void convert_f32_to_s16(const float* in, int16_t* out, size_t count) {
+    size_t i = 0;
+#if defined(PLANAR_RING_SSE2)
+    // Clamped before converting, as in the scalar tail: cvtps turns anything past the int32 range
+    // into 0x80000000, which packs would saturate to -32768 whatever the input's sign. The min is
+    // first so NaN also becomes 32767, as with std::min below.
+    const __m128 scale = _mm_set1_ps(32768.0f);
+    const __m128 lowest = _mm_set1_ps(-32768.0f);
+    const __m128 highest = _mm_set1_ps(32767.0f);
+    for (; i + 8 <= count; i += 8) {
+        const __m128 a = _mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(in + i), scale), highest), lowest);
+        const __m128 b = _mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(in + i + 4), scale), highest), lowest);
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+    }
+#elif defined(PLANAR_RING_NEON) && (defined(__aarch64__) || defined(__ARM_FEATURE_DIRECTED_ROUNDING))
+    // vcvtnq (round to nearest even, like nearbyint) is ARMv8 only; 32-bit ARMv7 NEON uses the
+    // scalar loop. vminq/vmaxq pass NaN through, so NaN lanes are replaced by 32767 first.
+    const float32x4_t lowest = vdupq_n_f32(-32768.0f);
+    const float32x4_t highest = vdupq_n_f32(32767.0f);
+    for (; i + 8 <= count; i += 8) {
+        const float32x4_t x = vmulq_n_f32(vld1q_f32(in + i), 32768.0f);
+        const float32x4_t y = vmulq_n_f32(vld1q_f32(in + i + 4), 32768.0f);
+        const float32x4_t a = vmaxq_f32(vminq_f32(vbslq_f32(vceqq_f32(x, x), x, highest), highest), lowest);
+        const float32x4_t b = vmaxq_f32(vminq_f32(vbslq_f32(vceqq_f32(y, y), y, highest), highest), lowest);
+        vst1q_s16(out + i, vcombine_s16(vmovn_s32(vcvtnq_s32_f32(a)), vmovn_s32(vcvtnq_s32_f32(b))));
+    }
+#endif
+    for (; i < count; ++i) {
+        const float scaled = std::nearbyint(in[i] * 32768.0f);
+        out[i] = (int16_t)std::max(-32768.0f, std::min(32767.0f, scaled));
+    }
+}
+
+void window_s16(const int16_t* in, const float* window, float* out, size_t count) {
+    size_t i = 0;
+#if defined(PLANAR_RING_SSE2)
+    for (; i + 8 <= count; i += 8) {
+        const __m128i x = _mm_loadu_si128((const __m128i*)(in + i));
+        const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+        const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), _mm_loadu_ps(window + i)));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), _mm_loadu_ps(window + i + 4)));
+    }
+#elif defined(PLANAR_RING_NEON)
+    for (; i + 8 <= count; i += 8) {
+        const int16x8_t x = vld1q_s16(in + i);
+        vst1q_f32(out + i, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))), vld1q_f32(window + i)));
+        vst1q_f32(out + i + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))), vld1q_f32(window + i + 4)));
+    }
+#endif
+    for (; i < count; ++i) out[i] = in[i] * window[i];
+}
+
+static inline void deinterleave(const float* in, float* const* out, int channels, size_t frames) {
+    deinterleave_f32(in, out, channels, frames);
+}
+
+static inline void deinterleave(const int16_t* in, int16_t* const* out, int channels, size_t frames) {
+    deinterleave_s16(in, out, channels, frames);
+}
+
+template <typename Sample>
+BasicPlanarRing<Sample>::BasicPlanarRing(int channels, size_t capacity_frames, size_t max_span_frames)
+    : channels_(channels),
+      capacity_(capacity_frames),
+      max_span_(std::min(max_span_frames, capacity_frames)),
+      data_(channels, std::vector<Sample>(capacity_frames + max_span_)) {
+    if (channels < 1 || channels > PLANAR_MAX_CHANNELS) {
+        throw std::invalid_argument("PlanarRing holds 1 to " + std::to_string(PLANAR_MAX_CHANNELS) + " channels");
+    }
+}
+
+template <typename Sample>
+void BasicPlanarRing<Sample>::write_interleaved(const Sample* in, size_t frames) {
+    const uint64_t written = written_.load(std::memory_order_relaxed);
+    Sample* dst[PLANAR_MAX_CHANNELS];
+    size_t done = 0;
+    while (done < frames) {
+        size_t pos = (written + done) % capacity_;
+        size_t n = std::min(frames - done, capacity_ - pos);
+        for (int c = 0; c < channels_; ++c) dst[c] = data_[c].data() + pos;
+        deinterleave(in + done * channels_, dst, channels_, n);
+
+        // Keep the mirrored tail in sync so spans starting near the end stay contiguous
+        if (pos < max_span_) {
+            size_t mirrored = std::min(n, max_span_ - pos);
+            for (int c = 0; c < channels_; ++c) {
+                std::memcpy(data_[c].data() + capacity_ + pos, data_[c].data() + pos, mirrored * sizeof(Sample));
+            }
+        }
+        done += n;
+    }
+    written_.store(written + frames, std::memory_order_release);
+}
+
+template class BasicPlanarRing<float>;
+template class BasicPlanarRing<int16_t>;
@@ -0,0 +1,86 @@
+// =================================================================================================
+// Planar (de-interleaved) capture ring for multi-channel audio
+// =================================================================================================
+//
+// The capture callback hands us interleaved frames (c0 c1 ... c7 c0 c1 ...). PlanarRing splits them
+// into one ring per channel as they arrive, so the processing side can read any channel's frame as a
+// single contiguous span instead of gathering samples with per-sample modulo indexing.
+//
+// Each channel ring keeps a mirrored tail: the first `max_span` frames are also stored just past the
+// end of the ring, so a span of up to `max_span` frames never has to wrap.
+//
+// The ring is single-producer / single-consumer. The producer publishes with a release store of the
+// total frame count; consumers acquire it with frames_written() before reading spans.
+//
+// Rings hold float (PlanarRing) or 16-bit samples (PlanarRingS16). A 16-bit ring takes the
+// device's native format as is, halving ring memory and bandwidth; the reader converts to float
+// while windowing (see stft_frame).
+// =================================================================================================
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// De-interleaves `frames` frames of `channels`-channel audio into the per-channel arrays in `out`.
+// Uses SSE/NEON 4x4 transposes when the channel count is a multiple of 4, scalar code otherwise.
+void deinterleave_f32(const float* in, float* const* out, int channels, size_t frames);
+
+// Same for 16-bit samples, with SSE2/NEON 8x8 transposes when the channel count is a multiple of 8.
+void deinterleave_s16(const int16_t* in, int16_t* const* out, int channels, size_t frames);
+
+// Most channels a ring (or CaptureBlockRing) holds; the writers keep one pointer per channel on the stack
+const int PLANAR_MAX_CHANNELS = 64;
+
+// --- 16-bit sample conversion (SSE2/NEON, scalar tails) ---
+const float S16_SCALE = 1.0f / 32768.0f; // int16 full scale -> [-1, 1)
+
+// out[i] = in[i] * S16_SCALE
+void convert_s16_to_f32(const int16_t* in, float* out, size_t count);
+
+// out[i] = in[i] * 32768, rounded to nearest and saturated to the int16 range
+void convert_f32_to_s16(const float* in, int16_t* out, size_t count);
+
+// out[i] = in[i] * window[i], converting the 16-bit samples on the fly so a 16-bit span can be
+// windowed without a separate conversion pass. Pre-scale the window by S16_SCALE for [-1, 1) output.
+void window_s16(const int16_t* in, const float* window, float* out, size_t count);
+
+// Instantiated for float and int16_t only (planar_ring.cpp).
+template <typename Sample>
+class BasicPlanarRing {
+public:
+    // Throws std::invalid_argument unless 1 <= channels <= PLANAR_MAX_CHANNELS
+    BasicPlanarRing(int channels, size_t capacity_frames, size_t max_span_frames);
+
+    // Producer side: de-interleaves and appends `frames` interleaved frames.
+    void write_interleaved(const Sample* in, size_t frames);
+
+    // Total number of frames ever written (monotonic, never wraps).
+    uint64_t frames_written() const { return written_.load(std::memory_order_acquire); }
+
+    // Pointer to `start_frame` (an absolute frame index) in channel `ch`. The next
+    // max_span() samples are contiguous.
+    const Sample* channel_span(int ch, uint64_t start_frame) const {
+        return data_[ch].data() + (start_frame % capacity_);
+    }
+
+    int channels() const { return channels_; }
+    size_t capacity() const { return capacity_; }
+    size_t max_span() const { return max_span_; }
+
+    // Channel ch's whole storage (capacity() + max_span() samples), e.g. for prefaulting
+    Sample* channel_storage(int ch) { return data_[ch].data(); }
+    size_t storage_frames() const { return capacity_ + max_span_; }
+
+private:
+    int channels_;
+    size_t capacity_;
+    size_t max_span_;
+    std::vector<std::vector<Sample>> data_; // [channel][capacity + max_span]
+    std::atomic<uint64_t> written_{0};
+};
+
+using PlanarRing = BasicPlanarRing<float>;
+using PlanarRingS16 = BasicPlanarRing<int16_t>;
@@ -16,10 +16,14 @@
 # pip install pandas matplotlib
 #
 # Usage:
-# python plot_waveforms.py
+# python plot_waveforms.py [capture.csv | capture.u8c]
+# Binary .u8c captures (tdoa_capture --format binary) are memory-mapped with numpy instead of parsed.
 #
 # ==============================================================================
 
+import struct
+import sys
+
 import pandas as pd
 import matplotlib.pyplot as plt
 import numpy as np
@@ -27,12 +31,40 @@ import numpy as np
 # --- Configuration ---
 CSV_FILENAME = "uma8_capture.csv"
 SAMPLE_RATE = 48000 # This must match the sample rate in the C++ program
+BLOCK_HEADER_BYTES = 256 # CAPTURE_FILE_BLOCK_HEADER_BYTES in capture_file.hpp
+
+def read_capture_file(path):
+    """Maps a .u8c capture (layout in capture_file.hpp) and returns it as a DataFrame."""
+    with open(path, "rb") as f:
+        header = f.read(88)
+    magic, version, header_bytes, sample_rate, channels, sample_format, block_frames, \
+        block_bytes, block_count, total_frames = struct.unpack("<8sIIiiIIQQQ", header[:56])
+    if magic != b"UMA8CAP\0" or version != 1:
+        raise ValueError(f"{path} is not a version 1 binary capture")
+    sample_type = np.int16 if sample_format == 1 else np.float32
+    if block_count == 0:
+        # The writer did not finish; use the complete blocks
+        block_count = (np.memmap(path, dtype=np.uint8, mode="r").size - header_bytes) // block_bytes
+        total_frames = block_count * block_frames
+    block_type = np.dtype({"names": ["samples"],
+                           "formats": [(sample_type, (channels, block_frames))],
+                           "offsets": [BLOCK_HEADER_BYTES],
+                           "itemsize": block_bytes})
+    blocks = np.memmap(path, dtype=block_type, mode="r", offset=header_bytes, shape=(block_count,))
+    # [block][channel][frame] -> [frame][channel]
+    samples = blocks["samples"].transpose(0, 2, 1).reshape(-1, channels)[:total_frames]
+    if sample_format == 1:
+        samples = samples / 32768.0
+    return pd.DataFrame(samples, columns=[f"Channel_{c}" for c in range(channels)])
 
 def analyze_and_plot_waveforms():
-    """Reads, analyzes, and plots waveform data from a CSV file."""
+    """Reads, analyzes, and plots waveform data from a CSV or .u8c capture file."""
     print(f"Reading audio data from '{CSV_FILENAME}'...")
     try:
-        df = pd.read_csv(CSV_FILENAME)
+        if CSV_FILENAME.endswith(".u8c"):
+            df = read_capture_file(CSV_FILENAME)
+        else:
+            df = pd.read_csv(CSV_FILENAME)
     except FileNotFoundError:
         print(f"Error: The file '{CSV_FILENAME}' was not found.")
         print("Please run the C++ capture program first to generate the data file.")
@@ -95,4 +127,6 @@ def analyze_and_plot_waveforms():
     plt.show()
 
 if __name__ == "__main__":
+    if len(sys.argv) > 1:
+        CSV_FILENAME = sys.argv[1]
     analyze_and_plot_waveforms()
\ No newline at end of file
@@ -0,0 +1,139 @@
+#include "result_log.hpp"
+
+#include <charconv>
+#include <chrono>
+#include <cstring>
+
+bool parse_result_log_format(const std::string& text, ResultLogFormat& format) {
+    if (text == "jsonl") {
+        format = ResultLogFormat::JsonLines;
+    } else if (text == "binary") {
+        format = ResultLogFormat::Binary;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* result_log_format_name(ResultLogFormat format) {
+    return format == ResultLogFormat::Binary ? "binary" : "jsonl";
+}
+
+ResultLogWriter::ResultLogWriter() : queue_(new SpscQueue<ResultLogRecord, QUEUE_RECORDS>()) {}
+
+bool ResultLogWriter::open(const std::string& path, ResultLogFormat format, const DoaConfig& config, std::string& error) {
+    close();
+    if (path == "-") {
+        file_ = stdout;
+        owns_file_ = false;
+    } else {
+        file_ = std::fopen(path.c_str(), format == ResultLogFormat::Binary ? "wb" : "w");
+        if (file_ == nullptr) {
+            error = "could not open " + path + " for writing";
+            return false;
+        }
+        owns_file_ = true;
+    }
+    // The batch is the only buffer, so each batch is a single write
+    std::setvbuf(file_, nullptr, _IONBF, 0);
+
+    format_ = format;
+    batch_.clear();
+    batch_.reserve(WRITE_BATCH_BYTES + 4096);
+    if (format == ResultLogFormat::Binary) {
+        ResultLogHeader header = {};
+        std::memcpy(header.magic, RESULT_LOG_MAGIC, sizeof(header.magic));
+        header.version = RESULT_LOG_VERSION;
+        header.record_size = sizeof(ResultLogRecord);
+        header.sample_rate = config.sample_rate;
+        header.hop_size = config.hop_size;
+        header.fft_size = config.fft_size;
+        batch_.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+
+    stop_ = false;
+    write_failed_ = false;
+    thread_ = std::thread(&ResultLogWriter::run, this);
+    return true;
+}
+
+void ResultLogWriter::close() {
+    if (file_ == nullptr) return;
+    stop_.store(true, std::memory_order_release);
+    wake_.notify();
+    thread_.join();
+    if (owns_file_) std::fclose(file_);
+    file_ = nullptr;
+}
+
+void ResultLogWriter::run() {
+    // Records are picked up by polling, so pushing one never costs the producer a wakeup
+    const auto poll_period = std::chrono::milliseconds(FLUSH_INTERVAL_MS / 5);
+    auto last_write = std::chrono::steady_clock::now();
+    while (true) {
+        const bool stopping = stop_.load(std::memory_order_acquire); // Read before the final drain
+        ResultLogRecord record;
+        while (queue_->try_pop(record)) {
+            format_record(record);
+            if (batch_.size() >= WRITE_BATCH_BYTES) {
+                write_batch();
+                last_write = std::chrono::steady_clock::now();
+            }
+        }
+        const auto now = std::chrono::steady_clock::now();
+        if (!batch_.empty() && (stopping || now - last_write >= std::chrono::milliseconds(FLUSH_INTERVAL_MS))) {
+            write_batch();
+            last_write = now;
+        }
+        if (stopping) break;
+        wake_.wait_for(poll_period, [&] { return stop_.load(std::memory_order_acquire); });
+    }
+}
+
+void ResultLogWriter::write_batch() {
+    if (!write_failed_ && std::fwrite(batch_.data(), 1, batch_.size(), file_) != batch_.size()) {
+        // Keep draining the queue so the producer's accounting stays right, but stop writing
+        write_failed_ = true;
+    }
+    batch_.clear();
+}
+
+void ResultLogWriter::format_record(const ResultLogRecord& record) {
+    written_.fetch_add(1, std::memory_order_relaxed);
+    if (format_ == ResultLogFormat::Binary) {
+        batch_.append(reinterpret_cast<const char*>(&record), sizeof(record));
+        return;
+    }
+
+    const size_t max_line_chars = 320; // A full record is under 250 characters
+    const size_t pos = batch_.size();
+    batch_.resize(pos + max_line_chars);
+    char* p = &batch_[pos];
+    char* const end = &batch_[0] + batch_.size();
+    auto text = [&](const char* s) {
+        const size_t length = std::strlen(s);
+        std::memcpy(p, s, length);
+        p += length;
+    };
+    text("{\"hop\":");
+    p = std::to_chars(p, end, record.hop).ptr;
+    text(",\"time_s\":");
+    p = std::to_chars(p, end, record.audio_time_s, std::chars_format::fixed, 5).ptr;
+    text(",\"capture_ns\":");
+    p = std::to_chars(p, end, record.capture_ns).ptr;
+    text(",\"unix_ns\":");
+    p = std::to_chars(p, end, record.capture_unix_ns).ptr;
+    text(",\"rms\":");
+    p = std::to_chars(p, end, record.rms_energy).ptr;
+    text(",\"noise_floor\":");
+    p = std::to_chars(p, end, record.noise_floor).ptr;
+    text(record.active ? ",\"active\":true" : ",\"active\":false");
+    text(",\"angle\":");
+    p = std::to_chars(p, end, (int)record.angle).ptr;
+    text(",\"power\":");
+    p = std::to_chars(p, end, record.beam_power).ptr;
+    text(",\"latency_ms\":");
+    p = std::to_chars(p, end, record.latency_ms, std::chars_format::fixed, 3).ptr;
+    text("}\n");
+    batch_.resize(p - &batch_[0]);
+}
@@ -0,0 +1,111 @@
+// =================================================================================================
+// Per-hop result log (JSON lines or binary) written from a background thread
+// =================================================================================================
+//
+// tdoa_realtime --log FILE records every published hop for later analysis. The publish stage only
+// pushes a fixed-size record into a lock-free queue; a writer thread formats the records and hands
+// them to the OS in large writes (WRITE_BATCH_BYTES, or whatever has built up every
+// FLUSH_INTERVAL_MS). Slow disks and pipes therefore never reach the processing threads: if the
+// queue fills up, records are dropped and counted instead.
+//
+// JSON lines: one object per hop, e.g.
+//   {"hop":16,"time_s":0.17067,"capture_ns":...,"unix_ns":...,"rms":0.0411,"noise_floor":0.0204,
+//    "active":true,"angle":17,"power":68605.3,"latency_ms":1.2}
+// Binary: a ResultLogHeader followed by ResultLogRecords, little-endian, exactly as declared below.
+// =================================================================================================
+
+#pragma once
+
+#include "doa_engine.hpp" // DoaConfig
+#include "spsc_queue.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+
+enum class ResultLogFormat { JsonLines, Binary };
+
+bool parse_result_log_format(const std::string& text, ResultLogFormat& format);
+const char* result_log_format_name(ResultLogFormat format);
+
+// One hop's result. Also the on-disk layout of a binary log.
+struct ResultLogRecord {
+    uint64_t hop;
+    int64_t capture_ns;      // Steady clock time the hop's last block arrived
+    int64_t capture_unix_ns; // The same instant on the system clock
+    double audio_time_s;     // Start of the hop's frame on the audio timeline
+    float rms_energy;
+    float noise_floor;       // VAD noise floor (RMS)
+    float beam_power;
+    float latency_ms;        // Capture to publish
+    int16_t angle;           // Degrees, -1 if the hop was silent
+    uint8_t active;          // VAD state
+    uint8_t reserved[5];
+};
+static_assert(sizeof(ResultLogRecord) == 56, "binary log records are 56 bytes");
+
+const char RESULT_LOG_MAGIC[8] = {'U', 'M', 'A', '8', 'D', 'O', 'A', '\0'};
+const uint32_t RESULT_LOG_VERSION = 1;
+
+// Start of a binary log
+struct ResultLogHeader {
+    char magic[8];           // RESULT_LOG_MAGIC
+    uint32_t version;
+    uint32_t record_size;    // sizeof(ResultLogRecord)
+    int32_t sample_rate;     // Rate and frame sizes the DOA engine ran at
+    int32_t hop_size;
+    int32_t fft_size;
+    int32_t reserved;
+};
+static_assert(sizeof(ResultLogHeader) == 32, "binary log header is 32 bytes");
+
+class ResultLogWriter {
+public:
+    static const size_t QUEUE_RECORDS = 8192;        // Over a minute of hops at 48 kHz
+    static const size_t WRITE_BATCH_BYTES = 1 << 20; // Formatted bytes collected before a write
+    static const int FLUSH_INTERVAL_MS = 250;        // Longest a record waits to reach the file
+
+    ResultLogWriter();
+    ResultLogWriter(const ResultLogWriter&) = delete;
+    ResultLogWriter& operator=(const ResultLogWriter&) = delete;
+    ~ResultLogWriter() { close(); }
+
+    // Opens `path` ("-" for stdout), writes the binary header if needed and starts the writer
+    // thread. Returns false and fills `error` on failure.
+    bool open(const std::string& path, ResultLogFormat format, const DoaConfig& config, std::string& error);
+
+    // Writes out everything queued so far and stops the writer thread
+    void close();
+
+    // Producer side (one thread). Never blocks or allocates; returns false if the record had to be
+    // dropped because the writer is too far behind.
+    bool push(const ResultLogRecord& record) {
+        if (queue_->try_push(record)) return true;
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    uint64_t records_written() const { return written_.load(std::memory_order_relaxed); }
+    uint64_t records_dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    bool write_failed() const { return write_failed_.load(std::memory_order_relaxed); }
+
+private:
+    void run();
+    void format_record(const ResultLogRecord& record);
+    void write_batch();
+
+    std::unique_ptr<SpscQueue<ResultLogRecord, QUEUE_RECORDS>> queue_;
+    ResultLogFormat format_ = ResultLogFormat::JsonLines;
+    std::FILE* file_ = nullptr;
+    bool owns_file_ = false;
+    std::string batch_;
+    std::thread thread_;
+    WakeSignal wake_;
+    std::atomic<bool> stop_{false};
+    std::atomic<uint64_t> written_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<bool> write_failed_{false};
+};
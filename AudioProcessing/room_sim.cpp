@@ -0,0 +1,178 @@
+#include "room_sim.hpp"
+#include "fft.hpp"
+#include "uma8_geometry.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+// --- Image-source rendering ---
+const int IMAGE_TAPS = 16;                // Windowed-sinc length used to place each image pulse
+const size_t MIN_BLOCK_FRAMES = 8192;     // Lower bound on overlap-add block size
+const int MAX_SOURCES = 16;
+const int RIR_LEAD = IMAGE_TAPS + 8;      // RIR samples kept ahead of the direct path to the array centre
+
+float absorption_for_rt60(const RoomConfig& room, float rt60_s) {
+    const double lx = room.size[0], ly = room.size[1], lz = room.size[2];
+    const double volume = lx * ly * lz;
+    const double surface = 2.0 * (lx * ly + lx * lz + ly * lz);
+    double alpha = 0.161 * volume / (surface * rt60_s);
+    return (float)std::min(std::max(alpha, 0.01), 1.0);
+}
+
+// Next power of two >= n
+static size_t next_pow2(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+static void inverse_fft(std::vector<std::complex<double>>& vec, const std::vector<std::complex<double>>& exp_table) {
+    for (auto& c : vec) c = std::conj(c);
+    Fft::transformRadix2(vec, exp_table);
+    const double scale = 1.0 / vec.size();
+    for (auto& c : vec) c = std::conj(c) * scale;
+}
+
+bool RoomRenderer::init(const SimConfig& sim, const RoomConfig& room, int threads, std::string& error) {
+    sim_ = &sim;
+    room_ = room;
+    const int source_count = (int)sim.sources.size();
+    if (source_count > MAX_SOURCES) {
+        error = "at most " + std::to_string(MAX_SOURCES) + " sources are supported in a room";
+        return false;
+    }
+
+    double centre[3];
+    for (int d = 0; d < 3; ++d) {
+        centre[d] = room.array_pos[d] >= 0 ? room.array_pos[d] : (d == 2 ? std::min(1.2, room.size[2] / 2.0) : room.size[d] / 2.0);
+    }
+    auto inside = [&](const double* p) {
+        for (int d = 0; d < 3; ++d) if (p[d] <= 0.0 || p[d] >= room.size[d]) return false;
+        return true;
+    };
+    for (int m = 0; m < CHANNEL_COUNT; ++m) {
+        mic_pos_[m][0] = centre[0] + MIC_POSITIONS[m].first;
+        mic_pos_[m][1] = centre[1] + MIC_POSITIONS[m].second;
+        mic_pos_[m][2] = centre[2];
+        if (!inside(mic_pos_[m])) {
+            error = "the array does not fit inside the room";
+            return false;
+        }
+    }
+    for (int s = 0; s < source_count; ++s) {
+        const double angle_rad = sim.sources[s].angle_deg * M_PI / 180.0;
+        source_pos_[s][0] = centre[0] + room.source_distance * std::cos(angle_rad);
+        source_pos_[s][1] = centre[1] + room.source_distance * std::sin(angle_rad);
+        source_pos_[s][2] = centre[2];
+        if (!inside(source_pos_[s])) {
+            error = "source " + std::to_string(s) + " at " + std::to_string(sim.sources[s].angle_deg) +
+                    " degrees lies outside the room; reduce the source distance";
+            return false;
+        }
+    }
+
+    // The furthest image of the highest order bounds the RIR length
+    const double diagonal = std::sqrt(room.size[0] * room.size[0] + room.size[1] * room.size[1] + room.size[2] * room.size[2]);
+    const double max_path = (room.max_order + 1) * diagonal + room.source_distance;
+    direct_delay_ = room.source_distance / SPEED_OF_SOUND * SAMPLE_RATE - RIR_LEAD;
+    rir_length_ = (size_t)std::ceil(max_path / SPEED_OF_SOUND * SAMPLE_RATE - direct_delay_) + IMAGE_TAPS;
+    fft_size_ = next_pow2(std::max(rir_length_, MIN_BLOCK_FRAMES) * 2);
+    block_frames_ = fft_size_ - rir_length_ + 1;
+    exp_table_ = Fft::makeExpTable(fft_size_);
+
+    // Each (source, mic) RIR is independent: spread them over the worker threads
+    rir_spectra_.assign(source_count, std::vector<ComplexVector>(CHANNEL_COUNT));
+    std::atomic<int> next_pair{0};
+    auto worker = [&]() {
+        std::vector<float> rir;
+        int pair;
+        while ((pair = next_pair.fetch_add(1)) < source_count * CHANNEL_COUNT) {
+            const int s = pair / CHANNEL_COUNT, m = pair % CHANNEL_COUNT;
+            compute_rir(s, m, rir);
+            ComplexVector& spectrum = rir_spectra_[s][m];
+            spectrum.assign(fft_size_, 0.0);
+            for (size_t i = 0; i < rir.size(); ++i) spectrum[i] = rir[i];
+            Fft::transformRadix2(spectrum, exp_table_);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int t = 0; t < std::max(1, threads); ++t) pool.emplace_back(worker);
+    for (auto& t : pool) t.join();
+    return true;
+}
+
+void RoomRenderer::compute_rir(int source, int mic, std::vector<float>& rir) const {
+    rir.assign(rir_length_, 0.0f);
+    const double beta = std::sqrt(1.0 - std::min(std::max((double)room_.absorption, 0.0), 1.0));
+    const double* src = source_pos_[source];
+    const double* rcv = mic_pos_[mic];
+    const double direct_gain = 4.0 * M_PI * room_.source_distance; // Unit gain at the array centre
+    const int n = room_.max_order;
+
+    // Image at (1-2u)*src + 2*l*L along each axis; it has |l-u| + |l| reflections on that axis
+    for (int lx = -n; lx <= n; ++lx) for (int ux = 0; ux <= 1; ++ux) {
+        const int rx = std::abs(lx - ux) + std::abs(lx);
+        if (rx > n) continue;
+        const double dx = (1 - 2 * ux) * src[0] + 2.0 * lx * room_.size[0] - rcv[0];
+        for (int ly = -n; ly <= n; ++ly) for (int uy = 0; uy <= 1; ++uy) {
+            const int ry = std::abs(ly - uy) + std::abs(ly);
+            if (rx + ry > n) continue;
+            const double dy = (1 - 2 * uy) * src[1] + 2.0 * ly * room_.size[1] - rcv[1];
+            for (int lz = -n; lz <= n; ++lz) for (int uz = 0; uz <= 1; ++uz) {
+                const int rz = std::abs(lz - uz) + std::abs(lz);
+                if (rx + ry + rz > n) continue;
+                const double dz = (1 - 2 * uz) * src[2] + 2.0 * lz * room_.size[2] - rcv[2];
+
+                const double distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+                const double delay = distance / SPEED_OF_SOUND * SAMPLE_RATE - direct_delay_;
+                const double gain = std::pow(beta, rx + ry + rz) * direct_gain / (4.0 * M_PI * distance);
+
+                // Band-limited pulse at the fractional delay
+                const int centre = (int)std::floor(delay);
+                for (int k = -IMAGE_TAPS / 2 + 1; k <= IMAGE_TAPS / 2; ++k) {
+                    const int idx = centre + k;
+                    if (idx < 0 || idx >= (int)rir_length_) continue;
+                    rir[idx] += (float)(gain * windowed_sinc(idx - delay, IMAGE_TAPS));
+                }
+            }
+        }
+    }
+}
+
+void RoomRenderer::render_chunk(int64_t start_frame, size_t frames, float* const* out) const {
+    for (int m = 0; m < CHANNEL_COUNT; ++m) std::fill(out[m], out[m] + frames, 0.0f);
+
+    // y[n] = sum_k h[k] s[n - k]: the chunk needs rir_length - 1 samples of source history. The
+    // output is read RIR_LEAD samples late, so the direct path to the array centre has zero delay.
+    const int64_t history = (int64_t)rir_length_ - 1;
+    const int64_t input_start = start_frame + RIR_LEAD - history;
+    const size_t input_frames = frames + history;
+
+    ComplexVector block(fft_size_);
+    ComplexVector product(fft_size_);
+    for (size_t s = 0; s < sim_->sources.size(); ++s) {
+        const SourceSpec& spec = sim_->sources[s];
+        for (size_t offset = 0; offset < input_frames; offset += block_frames_) {
+            const size_t count = std::min(block_frames_, input_frames - offset);
+            for (size_t i = 0; i < fft_size_; ++i) {
+                block[i] = i < count ? source_sample(spec, input_start + (int64_t)(offset + i)) : 0.0;
+            }
+            Fft::transformRadix2(block, exp_table_);
+
+            // Overlap-add into the chunk: input sample j contributes to output j .. j + rir_length - 1
+            for (int m = 0; m < CHANNEL_COUNT; ++m) {
+                const ComplexVector& h = rir_spectra_[s][m];
+                for (size_t i = 0; i < fft_size_; ++i) product[i] = block[i] * h[i];
+                inverse_fft(product, exp_table_);
+                for (size_t i = 0; i < count + rir_length_ - 1; ++i) {
+                    const int64_t out_index = (int64_t)(offset + i) - history;
+                    if (out_index < 0) continue;
+                    if (out_index >= (int64_t)frames) break;
+                    out[m][out_index] += (float)product[i].real();
+                }
+            }
+        }
+    }
+    add_mic_noise(*sim_, start_frame, frames, out);
+}
@@ -0,0 +1,58 @@
+// =================================================================================================
+// Single-writer sequence lock for publishing small snapshots between threads
+// =================================================================================================
+//
+// The writer never blocks and never waits for readers; a reader that races with a write simply
+// retries. The payload is copied through relaxed atomic words, so readers never observe a torn value
+// and the scheme stays within the C++ memory model.
+// =================================================================================================
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+template <typename T>
+class Seqlock {
+    static_assert(std::is_trivially_copyable<T>::value, "Seqlock payload must be trivially copyable");
+
+public:
+    // Writer only.
+    void store(const T& value) {
+        uint64_t words[WORDS] = {};
+        std::memcpy(words, &value, sizeof(T));
+
+        const uint64_t seq = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(seq + 1, std::memory_order_relaxed); // Odd: write in progress
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; ++i) data_[i].store(words[i], std::memory_order_relaxed);
+        sequence_.store(seq + 2, std::memory_order_release);
+    }
+
+    // Copies the latest value into `out`. Returns false if nothing has been stored yet.
+    bool load(T& out) const {
+        uint64_t words[WORDS];
+        while (true) {
+            const uint64_t before = sequence_.load(std::memory_order_acquire);
+            if (before & 1) continue; // Writer is mid-update
+            for (size_t i = 0; i < WORDS; ++i) words[i] = data_[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence_.load(std::memory_order_relaxed) == before) {
+                if (before == 0) return false;
+                std::memcpy(&out, words, sizeof(T));
+                return true;
+            }
+        }
+    }
+
+    // Number of completed stores; lets readers skip work when nothing changed.
+    uint64_t version() const { return sequence_.load(std::memory_order_acquire) / 2; }
+
+private:
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    std::atomic<uint64_t> sequence_{0};
+    std::atomic<uint64_t> data_[WORDS] = {};
+};
@@ -0,0 +1,86 @@
+// =================================================================================================
+// Bounded lock-free single-producer / single-consumer queue, plus a wakeup signal
+// =================================================================================================
+//
+// The real-time pipeline passes frame indices between its stages through SpscQueue. Push and pop
+// never lock or allocate. A stage that finds its input queue empty sleeps on a WakeSignal, which
+// the upstream stage raises after pushing.
+// =================================================================================================
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of 2");
+
+public:
+    // Producer only. Returns false if the queue is full.
+    bool try_push(const T& value) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == Capacity) return false;
+        slots_[tail & (Capacity - 1)] = value;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. Returns false if the queue is empty.
+    bool try_pop(T& value) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) return false;
+        value = slots_[head & (Capacity - 1)];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+    size_t size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+private:
+    alignas(64) std::atomic<size_t> head_{0}; // Next slot to pop (consumer)
+    alignas(64) std::atomic<size_t> tail_{0}; // Next slot to push (producer)
+    alignas(64) T slots_[Capacity];
+};
+
+// Sleeps a consumer until a producer notifies and the consumer's predicate holds. The mutex only
+// orders the wakeup against the predicate check; the data itself travels through lock-free queues.
+// notify() takes the mutex, so a real-time producer uses RealtimeWakeSignal (thread_util.hpp).
+class WakeSignal {
+public:
+    void notify() {
+        { std::lock_guard<std::mutex> lock(mutex_); }
+        cv_.notify_one();
+    }
+
+    void notify_all() {
+        { std::lock_guard<std::mutex> lock(mutex_); }
+        cv_.notify_all();
+    }
+
+    template <typename Predicate>
+    void wait(Predicate ready) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, ready);
+    }
+
+    // Same as wait(), but gives up after `timeout`. Returns the final value of the predicate.
+    template <typename Rep, typename Period, typename Predicate>
+    bool wait_for(const std::chrono::duration<Rep, Period>& timeout, Predicate ready) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return cv_.wait_for(lock, timeout, ready);
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+};
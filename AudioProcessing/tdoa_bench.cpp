@@ -0,0 +1,578 @@
+// =================================================================================================
+// UMA-8 DOA Accuracy and Throughput Benchmark
+// =================================================================================================
+//
+// Description:
+// This program runs the DOA engine used by tdoa_realtime (doa_engine.cpp) over a labeled corpus
+// of captures and reports how accurate and how fast it is, so every algorithmic change can be
+// checked for accuracy loss with one command.
+//
+// Each capture is a CSV in the tdoa_capture format with a ground-truth file next to it,
+// CAPTURE.labels.csv (source,type,angle_deg,start_s,end_s), as written by tdoa_synth. Recorded
+// captures can be labeled by hand in the same format; only angle_deg, start_s and end_s are used.
+//
+// Every hop is analysed exactly as the real-time pipeline does it (window, energy gate, FFT,
+// beamformer), single-threaded, and classified against the labels:
+//   - active: a source sounds for at least half of the frame. A detection is scored by the
+//     circular error to the nearest active source.
+//   - silent: no source overlaps the frame. Any detection is a false alarm.
+//   - hops that only partly overlap a source are left out of both.
+//
+// Reported per capture and for the whole corpus: detection rate, false alarm rate, angular error
+// (mean, RMS, median, p90, max), the share of active hops detected within --tolerance degrees,
+// frames per second and per-hop latency (p50/p99/max).
+//
+// --save-baseline writes the corpus totals and per-capture results to a text file; --baseline
+// compares a run against such a file and exits with status 1 if accuracy regressed. Throughput is
+// machine dependent, so a slowdown is only reported unless --fail-on-slowdown is given.
+//
+// --vad fixed|adaptive|flux selects the hop gating, as in tdoa_realtime; hops the VAD rejects skip
+// the beamformer and count as "no detection". The share of skipped hops is reported too.
+//
+// --batch N frames N hops at a time and beamforms the active ones in a single pass over the
+// steering table, as tdoa_realtime does when catching up on a backlog. Hop latency is then the
+// batch time shared equally between its hops.
+//
+// --decimate 3|4 runs the engine on the decimated stream, as tdoa_realtime --decimate does. The
+// decimator runs once per capture before timing starts, so frames/s covers the engine only.
+//
+// Compilation (Linux/macOS):
+// g++ -std=c++17 -O3 tdoa_bench.cpp doa_engine.cpp decimator.cpp vad.cpp fft.cpp planar_ring.cpp capture_io.cpp latency_histogram.cpp -o tdoa_bench -lpthread
+//
+// Usage:
+// ./tdoa_bench --save-baseline bench_baseline.txt corpus/*.csv
+// ./tdoa_bench --baseline bench_baseline.txt corpus/*.csv
+//
+// =================================================================================================
+
+#include "doa_engine.hpp"
+#include "decimator.hpp"
+#include "vad.hpp"
+#include "planar_ring.hpp"
+#include "capture_io.hpp"
+#include "latency_histogram.hpp"
+#include "uma8_geometry.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+// --- Configuration ---
+const double DEFAULT_TOLERANCE_DEG = 10.0;    // Error counted as "on target" in accuracy
+const double RATE_REGRESSION = 0.01;          // Allowed drop in detection/accuracy (or rise in false alarms)
+const double ERROR_REGRESSION_DEG = 1.0;      // Allowed rise in mean/p90 angular error
+const double DEFAULT_SLOWDOWN_PCT = 10.0;     // Frames/s drop reported as a slowdown
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchOptions {
+    std::vector<std::string> captures;
+    std::string baseline_path;      // Compare against this file
+    std::string save_baseline_path; // Write results to this file
+    double tolerance_deg = DEFAULT_TOLERANCE_DEG;
+    double slowdown_pct = DEFAULT_SLOWDOWN_PCT;
+    bool fail_on_slowdown = false;
+    int repeat = 1;                 // Timed passes over each capture
+    int decimation = 1;
+    VadMode vad_mode = VadMode::Adaptive;
+    int batch = 1;                  // Hops per batched beamformer pass
+};
+
+// One line of a labels file: a source sounding from angle_deg between start_s and end_s
+struct LabelInterval {
+    float angle_deg;
+    double start_s;
+    double end_s;
+};
+
+// Raw per-hop outcomes, accumulated per capture and for the whole corpus
+struct BenchTally {
+    uint64_t hops = 0;
+    uint64_t active_hops = 0;
+    uint64_t detected_active = 0;
+    uint64_t silent_hops = 0;
+    uint64_t false_alarms = 0;
+    uint64_t on_target = 0;
+    uint64_t skipped_hops = 0;      // Hops the VAD kept away from the beamformer
+    std::vector<double> errors_deg; // One per detected active hop
+    uint64_t timed_hops = 0;
+    double busy_s = 0.0;
+    LatencyHistogram latency;
+
+    // Adds everything but the latency histogram, which bench_capture fills for the corpus directly
+    void merge(const BenchTally& other) {
+        hops += other.hops;
+        active_hops += other.active_hops;
+        detected_active += other.detected_active;
+        silent_hops += other.silent_hops;
+        false_alarms += other.false_alarms;
+        on_target += other.on_target;
+        skipped_hops += other.skipped_hops;
+        errors_deg.insert(errors_deg.end(), other.errors_deg.begin(), other.errors_deg.end());
+        timed_hops += other.timed_hops;
+        busy_s += other.busy_s;
+    }
+};
+
+// Metric name -> value, in the order they are printed and stored
+using Metrics = std::vector<std::pair<std::string, double>>;
+
+// =================================================================================================
+//  Corpus Loading
+// =================================================================================================
+bool load_labels(const std::string& path, std::vector<LabelInterval>& labels, std::string& error) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        error = "Could not open " + path;
+        return false;
+    }
+    std::string line;
+    std::getline(file, line); // Header
+    int line_number = 1;
+    while (std::getline(file, line)) {
+        ++line_number;
+        if (line.empty() || line == "\r") continue;
+        LabelInterval label;
+        int source;
+        char type[64];
+        if (sscanf(line.c_str(), "%d,%63[^,],%f,%lf,%lf", &source, type, &label.angle_deg,
+                   &label.start_s, &label.end_s) != 5) {
+            error = path + ":" + std::to_string(line_number) + ": expected source,type,angle_deg,start_s,end_s";
+            return false;
+        }
+        labels.push_back(label);
+    }
+    return true;
+}
+
+// Loads a capture into one contiguous buffer per channel, decimated to the engine's rate
+bool load_planar_capture(const std::string& path, const DoaConfig& doa, std::vector<std::vector<float>>& planar,
+                         std::string& error) {
+    // At full rate the parser fills the per-channel buffers directly
+    if (doa.decimation == 1) return load_capture_csv_planar(path, CHANNEL_COUNT, planar, error);
+
+    std::vector<float> interleaved;
+    if (!load_capture_csv(path, CHANNEL_COUNT, interleaved, error)) return false;
+    size_t frames = interleaved.size() / CHANNEL_COUNT;
+    Decimator decimator(CHANNEL_COUNT, doa.decimation);
+    std::vector<float> decimated(decimator.max_output_frames(frames) * CHANNEL_COUNT);
+    frames = decimator.process(interleaved.data(), frames, decimated.data());
+    interleaved.swap(decimated);
+    planar.assign(CHANNEL_COUNT, std::vector<float>(frames));
+    float* out[CHANNEL_COUNT];
+    for (int c = 0; c < CHANNEL_COUNT; ++c) out[c] = planar[c].data();
+    deinterleave_f32(interleaved.data(), out, CHANNEL_COUNT, frames);
+    return true;
+}
+
+// =================================================================================================
+//  Scoring
+// =================================================================================================
+
+// Absolute difference between two bearings, 0-180 degrees
+double angular_error(double a, double b) {
+    double d = std::fmod(std::fabs(a - b), 360.0);
+    return d > 180.0 ? 360.0 - d : d;
+}
+
+// Scores one hop of the first pass against the labels
+void score_hop(size_t start, int angle, bool active, const std::vector<LabelInterval>& labels, const DoaConfig& doa,
+               const BenchOptions& options, BenchTally& tally) {
+    const double frame_start_s = (double)start / doa.sample_rate;
+    const double frame_end_s = (double)(start + doa.fft_size) / doa.sample_rate;
+    bool overlapped = false;
+    std::vector<float> active_angles;
+    for (const LabelInterval& label : labels) {
+        const double overlap = std::min(frame_end_s, label.end_s) - std::max(frame_start_s, label.start_s);
+        if (overlap <= 0.0) continue;
+        overlapped = true;
+        if (overlap * doa.sample_rate >= doa.fft_size / 2) active_angles.push_back(label.angle_deg);
+    }
+
+    ++tally.hops;
+    if (!active) ++tally.skipped_hops;
+    if (!active_angles.empty()) {
+        ++tally.active_hops;
+        if (angle < 0) return;
+        ++tally.detected_active;
+        double error = 180.0;
+        for (float truth : active_angles) error = std::min(error, angular_error(angle, truth));
+        tally.errors_deg.push_back(error);
+        if (error <= options.tolerance_deg) ++tally.on_target;
+    } else if (!overlapped) {
+        ++tally.silent_hops;
+        if (angle >= 0) ++tally.false_alarms;
+    }
+}
+
+// Runs the engine over one capture. The first pass is scored; every pass is timed, with hop
+// latencies recorded both per capture and for the corpus. With --batch N, hops are framed N at a
+// time and the active ones share one pass of the batched beamformer; each hop is then charged an
+// equal share of the batch's time.
+void bench_capture(const std::vector<std::vector<float>>& planar, const std::vector<LabelInterval>& labels,
+                   const DoaConfig& doa, const std::vector<SteeringVector>& steering, const std::vector<double>& window,
+                   const BenchOptions& options, BenchTally& tally, LatencyHistogram& corpus_latency) {
+    StftWorkspace workspace(doa);
+    std::vector<std::vector<ComplexVector>> batch_ffts(options.batch,
+                                                      std::vector<ComplexVector>(CHANNEL_COUNT, ComplexVector(doa.fft_size)));
+    std::vector<std::vector<ComplexVector>*> active_ffts(options.batch);
+    std::vector<std::pair<int, double>> active_results(options.batch);
+    std::vector<size_t> batch_starts;
+    std::vector<bool> batch_active;
+    const float* spans[CHANNEL_COUNT];
+    const size_t frames = planar[0].size();
+
+    for (int pass = 0; pass < options.repeat; ++pass) {
+        VoiceActivityDetector vad(options.vad_mode, doa);
+        for (size_t first = 0; first + doa.fft_size <= frames; first += (size_t)options.batch * doa.hop_size) {
+            const Clock::time_point batch_start = Clock::now();
+            batch_starts.clear();
+            batch_active.clear();
+            int active_count = 0;
+            for (size_t start = first; start + doa.fft_size <= frames && batch_starts.size() < (size_t)options.batch;
+                 start += doa.hop_size) {
+                for (int c = 0; c < CHANNEL_COUNT; ++c) spans[c] = planar[c].data() + start;
+                std::vector<ComplexVector>& channel_ffts = batch_ffts[active_count];
+
+                // Same gating as tdoa_realtime's STFT stage; the raw hop energy is normally
+                // accumulated by the capture callback
+                bool active = false;
+                if (options.vad_mode == VadMode::Fixed) {
+                    active = stft_frame(doa, spans, window, ENERGY_THRESHOLD, workspace, channel_ffts) >= ENERGY_THRESHOLD;
+                } else {
+                    const float* newest = planar[0].data() + start + doa.fft_size - doa.hop_size;
+                    float sum = 0.0f;
+                    for (int i = 0; i < doa.hop_size; ++i) sum += newest[i] * newest[i];
+                    if (vad.update_energy(sum / doa.hop_size)) {
+                        stft_frame(doa, spans, window, 0.0f, workspace, channel_ffts);
+                        active = vad.confirm_spectrum(channel_ffts[0]);
+                    }
+                }
+                if (active) active_ffts[active_count++] = &channel_ffts;
+                batch_starts.push_back(start);
+                batch_active.push_back(active);
+            }
+
+            if (active_count == 1) {
+                active_results[0] = calculate_doa_fft(doa, *active_ffts[0], steering);
+            } else if (active_count > 1) {
+                calculate_doa_fft_batch(doa, active_ffts.data(), active_count, steering, active_results.data());
+            }
+            const int64_t batch_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - batch_start).count();
+            const int64_t hop_ns = batch_ns / (int64_t)batch_starts.size();
+            for (size_t h = 0, next_active = 0; h < batch_starts.size(); ++h) {
+                tally.latency.record(hop_ns);
+                corpus_latency.record(hop_ns);
+                ++tally.timed_hops;
+                if (pass > 0) continue;
+                const int angle = batch_active[h] ? active_results[next_active++].first : -1;
+                score_hop(batch_starts[h], angle, batch_active[h], labels, doa, options, tally);
+            }
+            tally.busy_s += batch_ns * 1e-9;
+        }
+    }
+}
+
+// Value at `percentile` (0-100) of an ascending sorted list; 0 if empty
+double sorted_percentile(const std::vector<double>& sorted, double percentile) {
+    if (sorted.empty()) return 0.0;
+    size_t index = (size_t)std::ceil(percentile / 100.0 * sorted.size());
+    return sorted[std::min(sorted.size(), std::max<size_t>(index, 1)) - 1];
+}
+
+Metrics summarize(const BenchTally& tally) {
+    std::vector<double> errors = tally.errors_deg;
+    std::sort(errors.begin(), errors.end());
+    double sum = 0.0, sum_squares = 0.0;
+    for (double e : errors) {
+        sum += e;
+        sum_squares += e * e;
+    }
+    const double detected = std::max<double>(1.0, errors.size());
+    const double active = std::max<double>(1.0, tally.active_hops);
+    return {
+        {"hops", (double)tally.hops},
+        {"active_hops", (double)tally.active_hops},
+        {"silent_hops", (double)tally.silent_hops},
+        {"detection_rate", tally.detected_active / active},
+        {"false_alarm_rate", tally.false_alarms / std::max<double>(1.0, tally.silent_hops)},
+        {"accuracy", tally.on_target / active},
+        {"mean_error_deg", sum / detected},
+        {"rms_error_deg", std::sqrt(sum_squares / detected)},
+        {"median_error_deg", sorted_percentile(errors, 50.0)},
+        {"p90_error_deg", sorted_percentile(errors, 90.0)},
+        {"max_error_deg", errors.empty() ? 0.0 : errors.back()},
+        {"skip_rate", tally.skipped_hops / std::max<double>(1.0, tally.hops)},
+        {"frames_per_s", tally.busy_s > 0.0 ? tally.timed_hops / tally.busy_s : 0.0},
+        {"latency_p50_us", tally.latency.percentile(50.0) / 1000.0},
+        {"latency_p99_us", tally.latency.percentile(99.0) / 1000.0},
+        {"latency_max_us", tally.latency.max() / 1000.0},
+    };
+}
+
+double metric(const Metrics& metrics, const std::string& name) {
+    for (const auto& m : metrics) {
+        if (m.first == name) return m.second;
+    }
+    return 0.0;
+}
+
+void print_table_header() {
+    printf("%-28s %7s %7s %7s %7s %7s %7s %7s %7s %7s %9s %7s %7s\n", "capture", "hops", "active", "det%",
+           "false%", "acc%", "mean", "p90", "max", "skip%", "frames/s", "p50us", "p99us");
+}
+
+void print_table_row(const std::string& name, const Metrics& m) {
+    printf("%-28s %7.0f %7.0f %7.2f %7.2f %7.2f %7.2f %7.2f %7.2f %7.2f %9.0f %7.1f %7.1f\n", name.c_str(),
+           metric(m, "hops"), metric(m, "active_hops"), 100.0 * metric(m, "detection_rate"),
+           100.0 * metric(m, "false_alarm_rate"), 100.0 * metric(m, "accuracy"), metric(m, "mean_error_deg"),
+           metric(m, "p90_error_deg"), metric(m, "max_error_deg"), 100.0 * metric(m, "skip_rate"), metric(m, "frames_per_s"),
+           metric(m, "latency_p50_us"), metric(m, "latency_p99_us"));
+}
+
+// =================================================================================================
+//  Baselines
+// =================================================================================================
+// A baseline is one "<capture>.<metric> <value>" per line; "#" starts a comment. The corpus
+// totals use the name "total".
+
+bool save_baseline(const std::string& path, const std::vector<std::pair<std::string, Metrics>>& results,
+                   const BenchOptions& options, const DoaConfig& doa) {
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file) return false;
+    fprintf(file, "# tdoa_bench baseline (tolerance %.1f deg, %d Hz, FFT %d, hop %d, VAD %s)\n",
+            options.tolerance_deg, doa.sample_rate, doa.fft_size, doa.hop_size, vad_mode_name(options.vad_mode));
+    for (const auto& result : results) {
+        for (const auto& m : result.second) {
+            fprintf(file, "%s.%s %.6f\n", result.first.c_str(), m.first.c_str(), m.second);
+        }
+    }
+    return fclose(file) == 0;
+}
+
+bool load_baseline(const std::string& path, std::map<std::string, double>& values, std::string& error) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        error = "Could not open baseline " + path;
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        std::string key;
+        double value;
+        if (!(fields >> key >> value)) {
+            error = "Malformed baseline line: " + line;
+            return false;
+        }
+        values[key] = value;
+    }
+    return true;
+}
+
+// Direction in which a metric gets worse, and by how much it may move before it counts
+struct MetricRule {
+    const char* name;
+    double worse_sign;   // +1: higher is worse, -1: lower is worse
+    double allowed;      // Absolute change allowed (accuracy metrics)
+    bool speed;          // Compared relative to the baseline and governed by --fail-on-slowdown
+};
+
+const MetricRule METRIC_RULES[] = {
+    {"detection_rate",   -1.0, RATE_REGRESSION,      false},
+    {"false_alarm_rate", +1.0, RATE_REGRESSION,      false},
+    {"accuracy",         -1.0, RATE_REGRESSION,      false},
+    {"mean_error_deg",   +1.0, ERROR_REGRESSION_DEG, false},
+    {"p90_error_deg",    +1.0, ERROR_REGRESSION_DEG, false},
+    {"frames_per_s",     -1.0, 0.0,                  true},
+};
+
+// Prints the totals against the baseline plus any per-capture metric that regressed. Returns the
+// number of regressions that should fail the run.
+int compare_with_baseline(const std::map<std::string, double>& baseline,
+                          const std::vector<std::pair<std::string, Metrics>>& results, const BenchOptions& options) {
+    int failures = 0;
+    printf("\n%-40s %12s %12s %12s\n", "metric", "baseline", "current", "change");
+    for (const auto& result : results) {
+        const bool total = result.first == "total";
+        for (const MetricRule& rule : METRIC_RULES) {
+            if (rule.speed && !total) continue; // Single-capture timings are too noisy to judge
+            const std::string key = result.first + "." + rule.name;
+            const auto found = baseline.find(key);
+            if (found == baseline.end()) {
+                if (total) printf("%-40s %12s %12.4f\n", key.c_str(), "-", metric(result.second, rule.name));
+                continue;
+            }
+            const double before = found->second;
+            const double now = metric(result.second, rule.name);
+            bool regressed;
+            if (rule.speed) {
+                regressed = before > 0.0 && (before - now) / before * 100.0 > options.slowdown_pct;
+            } else {
+                regressed = (now - before) * rule.worse_sign > rule.allowed + 1e-9;
+            }
+            if (!total && !regressed) continue;
+
+            const char* verdict = "";
+            if (regressed) verdict = rule.speed ? (options.fail_on_slowdown ? "  SLOWER" : "  slower (not failing)") : "  REGRESSED";
+            if (rule.speed) {
+                printf("%-40s %12.1f %12.1f %+11.1f%%%s\n", key.c_str(), before, now,
+                       before > 0.0 ? (now - before) / before * 100.0 : 0.0, verdict);
+            } else {
+                const double change = std::fabs(now - before) < 5e-5 ? 0.0 : now - before;
+                printf("%-40s %12.4f %12.4f %+12.4f%s\n", key.c_str(), before, now, change, verdict);
+            }
+            if (regressed && (!rule.speed || options.fail_on_slowdown)) ++failures;
+        }
+        if (!total && baseline.find(result.first + ".hops") == baseline.end()) {
+            printf("%-40s not in baseline\n", result.first.c_str());
+        }
+    }
+    return failures;
+}
+
+// =================================================================================================
+//  Command Line
+// =================================================================================================
+void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [options] CAPTURE.csv [CAPTURE.csv ...]\n"
+              << "  Each CAPTURE.csv needs ground truth in CAPTURE.csv.labels.csv\n"
+              << "  --baseline FILE       Compare with a saved baseline; exit 1 on accuracy regression\n"
+              << "  --save-baseline FILE  Save this run as a baseline\n"
+              << "  --tolerance DEG       Error counted as on target (default 10)\n"
+              << "  --repeat N            Timed passes over each capture (default 1)\n"
+              << "  --decimate N          Run the engine at 16 kHz (3) or 12 kHz (4)\n"
+              << "  --vad MODE            fixed, adaptive (default) or flux\n"
+              << "  --batch N             Beamform N hops per steering-table pass (1-" << MAX_DOA_BATCH << ", default 1)\n"
+              << "  --slowdown PCT        Frames/s drop reported as slower (default 10)\n"
+              << "  --fail-on-slowdown    Also exit 1 when frames/s dropped by more than --slowdown\n";
+}
+
+// Labels files are skipped on the command line, so "corpus/*.csv" names just the captures
+bool is_labels_file(const std::string& path) {
+    const std::string suffix = ".labels.csv";
+    return path.size() > suffix.size() && path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool parse_options(int argc, char** argv, BenchOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        try {
+            if (arg == "--baseline" && has_value) {
+                options.baseline_path = argv[++i];
+            } else if (arg == "--save-baseline" && has_value) {
+                options.save_baseline_path = argv[++i];
+            } else if (arg == "--tolerance" && has_value) {
+                options.tolerance_deg = std::stod(argv[++i]);
+                if (options.tolerance_deg <= 0) return false;
+            } else if (arg == "--repeat" && has_value) {
+                options.repeat = std::stoi(argv[++i]);
+                if (options.repeat < 1) return false;
+            } else if (arg == "--decimate" && has_value) {
+                options.decimation = std::stoi(argv[++i]);
+            } else if (arg == "--batch" && has_value) {
+                options.batch = std::stoi(argv[++i]);
+                if (options.batch < 1 || options.batch > MAX_DOA_BATCH) return false;
+            } else if (arg == "--vad" && has_value) {
+                if (!parse_vad_mode(argv[++i], options.vad_mode)) return false;
+            } else if (arg == "--slowdown" && has_value) {
+                options.slowdown_pct = std::stod(argv[++i]);
+            } else if (arg == "--fail-on-slowdown") {
+                options.fail_on_slowdown = true;
+            } else if (!arg.empty() && arg[0] != '-') {
+                if (!is_labels_file(arg)) options.captures.push_back(arg);
+            } else {
+                return false;
+            }
+        } catch (...) {
+            return false;
+        }
+    }
+    return !options.captures.empty();
+}
+
+// Capture name used in the report and the baseline: the file name without its directory
+std::string capture_name(const std::string& path) {
+    const size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+// =================================================================================================
+//  Main Function
+// =================================================================================================
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    std::map<std::string, double> baseline;
+    if (!options.baseline_path.empty()) {
+        std::string error;
+        if (!load_baseline(options.baseline_path, baseline, error)) {
+            std::cerr << "Error: " << error << std::endl;
+            return -1;
+        }
+    }
+
+    DoaConfig doa;
+    std::string config_error;
+    if (!make_doa_config(options.decimation, doa, config_error)) {
+        std::cerr << "Error: " << config_error << std::endl;
+        return -1;
+    }
+    const std::vector<SteeringVector> steering = precompute_steering_vectors(doa);
+    const std::vector<double> window = make_analysis_window(doa);
+
+    std::vector<std::pair<std::string, Metrics>> results;
+    BenchTally total;
+    print_table_header();
+    for (const std::string& path : options.captures) {
+        std::string error;
+        std::vector<LabelInterval> labels;
+        std::vector<std::vector<float>> planar;
+        if (!load_labels(path + ".labels.csv", labels, error) || !load_planar_capture(path, doa, planar, error)) {
+            std::cerr << "Error: " << error << std::endl;
+            return -1;
+        }
+
+        BenchTally tally;
+        bench_capture(planar, labels, doa, steering, window, options, tally, total.latency);
+        Metrics metrics = summarize(tally);
+        print_table_row(capture_name(path), metrics);
+        results.emplace_back(capture_name(path), std::move(metrics));
+        total.merge(tally);
+    }
+    Metrics totals = summarize(total);
+    print_table_row("total", totals);
+    results.emplace_back("total", std::move(totals));
+
+    int failures = 0;
+    if (!options.baseline_path.empty()) {
+        failures = compare_with_baseline(baseline, results, options);
+        if (failures > 0) {
+            printf("\nFAIL: %d regression(s) against %s\n", failures, options.baseline_path.c_str());
+        } else {
+            printf("\nPASS: no regressions against %s\n", options.baseline_path.c_str());
+        }
+    }
+    if (!options.save_baseline_path.empty()) {
+        if (!save_baseline(options.save_baseline_path, results, options, doa)) {
+            std::cerr << "Error: Could not write " << options.save_baseline_path << std::endl;
+            return -1;
+        }
+        printf("Saved baseline to %s\n", options.save_baseline_path.c_str());
+    }
+    return failures > 0 ? 1 : 0;
+}
@@ -5,6 +5,7 @@
 // Description:
 // This program captures 8 channels of audio and saves the raw sample data to a CSV file.
 // This CSV file can then be easily plotted and analyzed by other programs, like a Python script.
+// The file is written while recording, so a capture can run for hours in constant memory.
 //
 // Dependencies:
 // - miniaudio: A single-file audio library. Just download "miniaudio.h" and place it
@@ -12,77 +13,147 @@
 //   Get it here: https://miniaud.io/
 //
 // Compilation (Linux/macOS):
-// g++ -std=c++17 tdoa_capture.cpp -o tdoa_capture -lpthread
+// g++ -std=c++17 tdoa_capture.cpp capture_blocks.cpp capture_writer.cpp capture_file.cpp capture_compress.cpp capture_io.cpp planar_ring.cpp thread_util.cpp -o tdoa_capture -lpthread
 //
 // Usage:
-// ./tdoa_capture
+// ./tdoa_capture [--duration S] [--format csv|binary|wav|compressed] [--out FILE] [--rotate-mb N] [--rotate-minutes N] [--s16] [--realtime] [--lock-memory]
+// The callback de-interleaves each buffer into a preallocated ring of 100 ms blocks
+// (capture_blocks.hpp), without locking or allocating. A writer thread appends finished blocks to
+// the output file and hands them back, so the ring only has to cover 4 s of disk stalls; frames
+// that arrive while it is full are dropped, counted and saved as silence, so the file keeps the
+// capture's timeline. --duration 0 records until Enter is pressed.
+// --rotate-mb / --rotate-minutes split the recording into numbered files (uma8_capture_000.csv, ...),
+// each with its own header, whenever the current file reaches the size or audio-duration limit.
+// --format binary writes the .u8c container of capture_file.hpp instead of CSV: raw planar blocks
+// with capture timestamps, per-block peak/RMS, the array geometry and a block index.
+// --s16 captures the device's native 16-bit samples, halving capture memory; they are scaled
+// to [-1, 1) floats when the CSV is written, so the CSV format is unchanged. The binary format
+// stores them as int16, halving the file size.
+// --format wav writes a standard 8-channel WAV (32-bit float, or 16-bit PCM with --s16) through
+// miniaudio's encoder, which opens directly in audio editors. WAV sizes are 32-bit, so a WAV
+// recording continues in FILE_001.wav, FILE_002.wav, ... every ~3.75 GB (about 43 min of float).
+// --format compressed writes the lossless .u8z format of capture_compress.hpp (FLAC-style
+// prediction and Rice coding, about 2x smaller than int16 samples and 4x smaller than float32);
+// the writer thread encodes it, so the callback is unaffected.
+// Without --format, the format follows the --out extension (.wav, .u8c, .u8z, otherwise CSV).
+// --realtime asks for a SCHED_FIFO capture thread and --lock-memory locks the capture buffers in
+// RAM (both usually need privileges); settings that could not be applied are reported.
 //
 // Author: Gemini
 // =================================================================================================
 
 #define MINIAUDIO_IMPLEMENTATION
 #include "miniaudio.h"
+#include "uma8_geometry.hpp" // SAMPLE_RATE, CHANNEL_COUNT, MIC_POSITIONS
+#include "thread_util.hpp"
+#include "capture_blocks.hpp"
+#include "capture_writer.hpp"
 
 #include <iostream>
 #include <vector>
 #include <thread>
 #include <chrono>
-#include <mutex>
+#include <atomic>
 #include <cmath>
 #include <string>
 #include <algorithm> // For std::max_element
-#include <fstream>   // For file writing
+#include <type_traits>
+#include <limits>
 
 // --- Configuration ---
-const int SAMPLE_RATE = 48000;
-const int CHANNEL_COUNT = 8;
-const int CAPTURE_DURATION_MS = 10000; // Capture for 10 seconds for a more manageable file size
+const int CAPTURE_DURATION_MS = 10000; // Default capture length (--duration overrides it)
 const std::string OUTPUT_FILENAME = "uma8_capture.csv";
+const std::string BINARY_OUTPUT_FILENAME = "uma8_capture.u8c"; // Default with --format binary
+const std::string WAV_OUTPUT_FILENAME = "uma8_capture.wav";      // Default with --format wav
+const std::string COMPRESSED_OUTPUT_FILENAME = "uma8_capture.u8z"; // Default with --format compressed
+const size_t CAPTURE_BLOCK_FRAMES = SAMPLE_RATE / 10; // 100 ms per storage block
+const size_t CAPTURE_BLOCKS = 40; // 4 s of audio between the callback and the writer thread
+const int WRITER_POLL_MS = 50;    // How often the writer thread collects finished blocks
 
 // --- Global Data Structures ---
 struct UserData {
-    std::vector<std::vector<float>> audio_channels;
-    std::mutex data_mutex;
+    // Blocks the callback fills and the writer thread drains, allocated before the device starts.
+    // Only the block ring matching the capture format is sized.
+    CaptureBlockRing<float> blocks;
+    CaptureBlockRing<int16_t> blocks_s16; // Used instead with --s16
 
-    UserData() : audio_channels(CHANNEL_COUNT) {}
+    // Whether miniaudio's capture thread got a real-time policy: -1 until the first callback
+    std::atomic<int> capture_thread_realtime{-1};
+
+    explicit UserData(bool s16)
+        : blocks(CHANNEL_COUNT, CAPTURE_BLOCK_FRAMES, s16 ? 0 : CAPTURE_BLOCKS, SAMPLE_RATE),
+          blocks_s16(CHANNEL_COUNT, CAPTURE_BLOCK_FRAMES, s16 ? CAPTURE_BLOCKS : 0, SAMPLE_RATE) {}
 };
 
 // =================================================================================================
-//  Save Audio Data to CSV File
+//  Streaming Writer
 // =================================================================================================
-void save_audio_to_csv(const std::vector<std::vector<float>>& audio_data) {
-    std::cout << "\n--- Saving captured audio to " << OUTPUT_FILENAME << " ---" << std::endl;
-    if (audio_data.empty() || audio_data[0].empty()) {
-        std::cout << "No audio data to save." << std::endl;
-        return;
-    }
+// Drains complete blocks to disk while the capture runs and hands each block back to the callback
+// once it is written. After the device has stopped (`device_stopped`), the partial last block is
+// written too. Frames the callback had to drop are written as silence, so frame f of the output is
+// always capture frame f.
+template <typename Sample>
+void writer_thread_func(CaptureBlockRing<Sample>* blocks, RotatingCaptureWriter* writer,
+                        const std::atomic<bool>* device_stopped, std::string* error) {
+    const uint64_t block_frames = blocks->block_frames();
+    const Sample* channels[CHANNEL_COUNT];
+    const std::vector<Sample> zeros(block_frames, Sample(0));
+    const Sample* silent_channels[CHANNEL_COUNT];
+    for (int j = 0; j < CHANNEL_COUNT; ++j) silent_channels[j] = zeros.data();
+    uint64_t position = 0;       // Ring frame
+    uint64_t gap_frames = 0;     // Silence written so far: output frame = position + gap_frames
+    int64_t next_time_ns = 0;    // Capture time of the frame after the last one written, 0 if unknown
+    bool failed = false;
 
-    std::ofstream output_file(OUTPUT_FILENAME);
-    if (!output_file.is_open()) {
-        std::cerr << "Error: Could not open file " << OUTPUT_FILENAME << " for writing." << std::endl;
-        return;
-    }
+    // After a write error the blocks are still released, so the capture keeps its timeline
+    auto write = [&](const Sample* const* planar, size_t frames, int64_t time_unix_ns) {
+        CaptureChunk chunk;
+        if constexpr (std::is_same<Sample, int16_t>::value) {
+            chunk.s16 = planar;
+        } else {
+            chunk.f32 = planar;
+        }
+        chunk.frames = frames;
+        chunk.first_frame = position + gap_frames;
+        chunk.time_unix_ns = time_unix_ns;
+        if (!failed && !writer->write(chunk, *error)) failed = true;
+        next_time_ns = time_unix_ns == 0 ? 0 : time_unix_ns + (int64_t)(frames * 1e9 / SAMPLE_RATE);
+    };
+    // Silence up to `dropped` frames in total; `resume_ns` is when the audio after it was captured
+    auto fill_gap = [&](uint64_t dropped, int64_t resume_ns) {
+        while (gap_frames < dropped) {
+            const size_t frames = (size_t)std::min(block_frames, dropped - gap_frames);
+            const uint64_t before_resume = dropped - gap_frames;
+            write(silent_channels, frames, resume_ns == 0 ? 0 : resume_ns - (int64_t)(before_resume * 1e9 / SAMPLE_RATE));
+            gap_frames += frames;
+        }
+    };
 
-    // Write the header row
-    for (int i = 0; i < CHANNEL_COUNT; ++i) {
-        output_file << "Channel_" << i << (i == CHANNEL_COUNT - 1 ? "" : ",");
-    }
-    output_file << "\n";
+    while (true) {
+        const bool stopping = device_stopped->load(); // Read before frames_written, so nothing is left behind
+        const uint64_t written = blocks->frames_written();
+        const uint64_t available = stopping ? written : written / block_frames * block_frames;
+        while (position < available) {
+            const uint64_t block = position / block_frames;
+            const uint64_t offset = position % block_frames;
+            const size_t frames = (size_t)std::min(block_frames - offset, available - position);
+            for (int j = 0; j < CHANNEL_COUNT; ++j) channels[j] = blocks->block_channel(block, j) + offset;
+            const int64_t block_time = blocks->block_time_ns(block);
+            if (offset == 0) fill_gap(blocks->block_dropped_before(block), block_time);
 
-    // Write the sample data row by row
-    size_t num_samples = audio_data[0].size();
-    for (size_t i = 0; i < num_samples; ++i) {
-        for (int j = 0; j < CHANNEL_COUNT; ++j) {
-            output_file << audio_data[j][i] << (j == CHANNEL_COUNT - 1 ? "" : ",");
+            write(channels, frames, block_time == 0 ? 0 : block_time + (int64_t)(offset * 1e9 / SAMPLE_RATE));
+            position += frames;
+            if (position % block_frames == 0) blocks->release_until(position / block_frames);
         }
-        output_file << "\n";
+        if (stopping) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(WRITER_POLL_MS));
     }
-
-    output_file.close();
-    std::cout << "Successfully saved " << num_samples << " samples for each of the " << CHANNEL_COUNT << " channels." << std::endl;
+    // Frames dropped at the very end still count towards the recording's length
+    const uint64_t dropped = blocks->dropped_frames();
+    const uint64_t tail = dropped - std::min(dropped, gap_frames);
+    fill_gap(dropped, next_time_ns == 0 ? 0 : next_time_ns + (int64_t)(tail * 1e9 / SAMPLE_RATE));
 }
 
-
 // =================================================================================================
 //  Audio Callback Function
 // =================================================================================================
@@ -90,30 +161,126 @@ void data_callback(ma_device* pDevice, void* pOutput, const void* pInput, ma_uin
     (void)pOutput; // Unused for capture
     UserData* pUserData = (UserData*)pDevice->pUserData;
     if (pUserData == nullptr) return;
+    if (pUserData->capture_thread_realtime.load(std::memory_order_relaxed) < 0) {
+        pUserData->capture_thread_realtime.store(current_thread_is_realtime() ? 1 : 0, std::memory_order_relaxed);
+    }
+
+    // The buffer's first frame was captured one buffer length ago
+    const int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    const int64_t time_ns = now_ns - (int64_t)(frameCount * 1e9 / SAMPLE_RATE);
+
+    // If the writer is 4 s behind, frames are dropped (and counted) rather than waited for
+    if (pDevice->capture.format == ma_format_s16) {
+        pUserData->blocks_s16.write_interleaved((const int16_t*)pInput, frameCount, time_ns);
+    } else {
+        pUserData->blocks.write_interleaved((const float*)pInput, frameCount, time_ns);
+    }
+}
 
-    const float* pInputF32 = (const float*)pInput;
-    std::lock_guard<std::mutex> lock(pUserData->data_mutex);
+// =================================================================================================
+//  Command Line
+// =================================================================================================
+struct CaptureOptions {
+    bool s16 = false;
+    bool realtime = false;
+    bool lock_memory = false;
+    double duration_s = CAPTURE_DURATION_MS / 1000.0; // 0 records until Enter is pressed
+    std::string out_path;     // Default depends on the format
+    CaptureFileFormat format = CaptureFileFormat::Csv;
+    bool format_given = false; // Otherwise the format follows the --out extension
+    CaptureRotation rotation;
+};
 
-    for (ma_uint32 i = 0; i < frameCount; ++i) {
-        for (int j = 0; j < CHANNEL_COUNT; ++j) {
-            pUserData->audio_channels[j].push_back(pInputF32[i * CHANNEL_COUNT + j]);
+void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --duration S        Seconds to record (default " << CAPTURE_DURATION_MS / 1000
+              << "); 0 records until Enter is pressed\n"
+              << "  --format F          csv, binary (.u8c, see capture_file.hpp), wav or compressed (.u8z, lossless)\n"
+              << "                      (default: from --out, else csv)\n"
+              << "  --out FILE          Output file (default " << OUTPUT_FILENAME << ", or .u8c / .wav / .u8z)\n"
+              << "  --rotate-mb N       Start a new numbered file every N MB\n"
+              << "  --rotate-minutes N  Start a new numbered file every N minutes of audio\n"
+              << "  --s16               Capture 16-bit samples (scaled to [-1, 1) in the output)\n"
+              << "  --realtime          Ask for a real-time capture thread\n"
+              << "  --lock-memory       Lock the capture buffers in RAM\n";
+}
+
+bool parse_options(int argc, char** argv, CaptureOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        try {
+            if (arg == "--s16") {
+                options.s16 = true;
+            } else if (arg == "--realtime") {
+                options.realtime = true;
+            } else if (arg == "--lock-memory") {
+                options.lock_memory = true;
+            } else if (arg == "--duration" && has_value) {
+                options.duration_s = std::stod(argv[++i]);
+                if (options.duration_s < 0.0) return false;
+            } else if (arg == "--out" && has_value) {
+                options.out_path = argv[++i];
+                if (options.out_path.empty()) return false;
+            } else if (arg == "--format" && has_value) {
+                if (!parse_capture_file_format(argv[++i], options.format)) return false;
+                options.format_given = true;
+            } else if (arg == "--rotate-mb" && has_value) {
+                const double megabytes = std::stod(argv[++i]);
+                if (megabytes <= 0.0) return false;
+                options.rotation.max_bytes = (uint64_t)(megabytes * 1024 * 1024);
+            } else if (arg == "--rotate-minutes" && has_value) {
+                options.rotation.max_seconds = std::stod(argv[++i]) * 60.0;
+                if (options.rotation.max_seconds <= 0.0) return false;
+            } else {
+                return false;
+            }
+        } catch (...) {
+            return false;
+        }
+    }
+    if (!options.format_given && !options.out_path.empty()) {
+        options.format = capture_file_format_for_path(options.out_path);
+    }
+    if (options.out_path.empty()) {
+        switch (options.format) {
+            case CaptureFileFormat::Csv: options.out_path = OUTPUT_FILENAME; break;
+            case CaptureFileFormat::Binary: options.out_path = BINARY_OUTPUT_FILENAME; break;
+            case CaptureFileFormat::Wav: options.out_path = WAV_OUTPUT_FILENAME; break;
+            case CaptureFileFormat::Compressed: options.out_path = COMPRESSED_OUTPUT_FILENAME; break;
         }
     }
+    return true;
 }
 
 // =================================================================================================
 //  Main Function
 // =================================================================================================
-int main() {
+int main(int argc, char** argv) {
+    CaptureOptions options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage(argv[0]);
+        return -1;
+    }
+    const bool s16 = options.s16;
+    const bool realtime = options.realtime;
+
+    // Settings that were requested but did not take effect, repeated at the end
+    std::vector<std::string> setup_failures;
+
     ma_result result;
     ma_context context;
     ma_device_info* pCaptureDeviceInfos;
     ma_uint32 captureDeviceCount;
     ma_device_config deviceConfig;
     ma_device device;
-    UserData userData;
+    UserData userData(s16);
 
-    if (ma_context_init(NULL, 0, NULL, &context) != MA_SUCCESS) {
+    // miniaudio quietly falls back to a normal thread if real-time is refused; the callback checks
+    ma_context_config contextConfig = ma_context_config_init();
+    if (realtime) contextConfig.threadPriority = ma_thread_priority_realtime;
+    if (ma_context_init(NULL, 0, &contextConfig, &context) != MA_SUCCESS) {
         std::cerr << "Failed to initialize context." << std::endl;
         return -1;
     }
@@ -141,6 +308,7 @@ int main() {
     } else {
         std::cout << "Please select a device index: ";
         std::cin >> selectedDeviceIndex;
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); // So Enter stops the recording later
         if (selectedDeviceIndex >= captureDeviceCount) {
             std::cerr << "Invalid device index." << std::endl;
             ma_context_uninit(&context);
@@ -152,7 +320,7 @@ int main() {
 
     deviceConfig = ma_device_config_init(ma_device_type_capture);
     deviceConfig.capture.pDeviceID = &pCaptureDeviceInfos[selectedDeviceIndex].id;
-    deviceConfig.capture.format    = ma_format_f32;
+    deviceConfig.capture.format    = s16 ? ma_format_s16 : ma_format_f32;
     deviceConfig.capture.channels  = CHANNEL_COUNT;
     deviceConfig.sampleRate        = SAMPLE_RATE;
     deviceConfig.dataCallback      = data_callback;
@@ -167,26 +335,83 @@ int main() {
     
     std::cout << "Device Name: " << pCaptureDeviceInfos[selectedDeviceIndex].name << std::endl;
 
+    // The first output file is opened before recording starts, so a bad path fails early
+    RotatingCaptureWriter writer;
+    CaptureStreamInfo stream_info;
+    stream_info.sample_rate = SAMPLE_RATE;
+    stream_info.channels = CHANNEL_COUNT;
+    stream_info.s16 = s16;
+    stream_info.speed_of_sound = SPEED_OF_SOUND;
+    stream_info.mic_positions = MIC_POSITIONS;
+    std::string write_error;
+    if (!writer.open(options.out_path, options.format, stream_info, options.rotation, write_error)) {
+        std::cerr << "Error: " << write_error << std::endl;
+        ma_device_uninit(&device);
+        ma_context_uninit(&context);
+        return -1;
+    }
+
+    if (options.lock_memory) {
+        // Locking faults in the capture blocks as well
+        std::string error;
+        if (!lock_process_memory(error)) {
+            setup_failures.push_back("could not lock memory: " + error);
+            std::cerr << "Warning: " << setup_failures.back() << std::endl;
+        }
+    }
+
+    const std::string first_path = writer.current_path(); // The writer thread owns `writer` from here on
+    std::atomic<bool> device_stopped{false};
+    std::thread writer_thread;
+    if (s16) {
+        writer_thread = std::thread(writer_thread_func<int16_t>, &userData.blocks_s16, &writer, &device_stopped, &write_error);
+    } else {
+        writer_thread = std::thread(writer_thread_func<float>, &userData.blocks, &writer, &device_stopped, &write_error);
+    }
+
     result = ma_device_start(&device);
     if (result != MA_SUCCESS) {
+        device_stopped = true;
+        writer_thread.join();
         ma_device_uninit(&device);
         ma_context_uninit(&context);
         std::cerr << "Failed to start device. Error: " << ma_result_description(result) << std::endl;
         return -1;
     }
 
-    std::cout << "Recording for " << CAPTURE_DURATION_MS << " ms... (Try making some noise!)" << std::endl;
-    std::this_thread::sleep_for(std::chrono::milliseconds(CAPTURE_DURATION_MS));
+    std::cout << "Recording to " << first_path << "... (Try making some noise!)" << std::endl;
+    if (options.duration_s > 0.0) {
+        std::cout << "Stopping after " << options.duration_s << " s." << std::endl;
+        std::this_thread::sleep_for(std::chrono::duration<double>(options.duration_s));
+    } else {
+        std::cout << "Press Enter to stop." << std::endl;
+        std::string line;
+        std::getline(std::cin, line);
+    }
 
     ma_device_uninit(&device);
     ma_context_uninit(&context);
+    device_stopped = true;
+    writer_thread.join();
+    bool write_ok = write_error.empty();
+    if (!writer.close(write_error)) write_ok = false;
 
     std::cout << "Recording finished." << std::endl;
-
-    {
-        std::lock_guard<std::mutex> lock(userData.data_mutex);
-        save_audio_to_csv(userData.audio_channels);
+    if (realtime && userData.capture_thread_realtime.load() != 1) {
+        setup_failures.push_back("the capture thread did not get real-time priority");
     }
+    for (const std::string& failure : setup_failures) std::cerr << "Not applied: " << failure << std::endl;
+    const uint64_t dropped = s16 ? userData.blocks_s16.dropped_frames() : userData.blocks.dropped_frames();
+    if (dropped > 0) std::cerr << "Warning: " << dropped << " frames were dropped because the disk fell behind (saved as silence)." << std::endl;
+    if (!write_ok) {
+        std::cerr << "Error: " << write_error << std::endl;
+        return -1;
+    }
+
+    std::cout << "Successfully saved " << writer.frames_written() << " samples for each of the " << CHANNEL_COUNT
+              << " channels (" << writer.bytes_written() / (1024 * 1024) << " MB";
+    if (writer.files_started() > 1) std::cout << " in " << writer.files_started() << " files";
+    std::cout << ")." << std::endl;
 
     std::cout << "\nTo visualize the data, run the Python script: python plot_waveforms.py" << std::endl;
 
@@ -0,0 +1,143 @@
+// =================================================================================================
+// UMA-8 DOA Result Listener
+// =================================================================================================
+//
+// Description:
+// Follows the results tdoa_realtime publishes with --shm and prints them as CSV, one line per hop.
+// It is the reference consumer of the shared-memory ring in doa_shm.hpp: records are formatted
+// straight out of the mapping (no copy), and the only syscall in the loop is the sleep between
+// polls. Any number of listeners can run at once without affecting the publisher.
+//
+// Compilation (Linux/macOS):
+// g++ -std=c++17 -O2 tdoa_listen.cpp doa_shm.cpp -o tdoa_listen
+//
+// Usage:
+// ./tdoa_listen [--name /uma8_doa] [--history N] [--map]
+// --history N first prints up to the N most recent results still in the ring, --map appends the
+// 360-degree power map to every line. Exits when the publisher does.
+//
+// =================================================================================================
+
+#include "doa_shm.hpp"
+
+#include <iostream>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+
+struct ListenOptions {
+    std::string name = DOA_SHM_DEFAULT_NAME;
+    uint64_t history = 0;
+    bool print_map = false;
+};
+
+// Formats one record into `line`; the caller only prints it if the record was not overwritten
+static int format_record(const DoaShmRecord& record, bool print_map, char* line, size_t size) {
+    int length = snprintf(line, size, "%llu,%.4f,%lld,%.5f,%.5f,%d,%d,%.4f",
+                          (unsigned long long)record.hop, record.audio_time_s, (long long)record.capture_unix_ns,
+                          record.rms_energy, record.noise_floor, (int)record.active,
+                          record.peak_count > 0 ? (int)record.peak_angles[0] : -1,
+                          record.peak_count > 0 ? record.peak_powers[0] : 0.0f);
+    for (int i = 1; i < DOA_SHM_MAX_PEAKS; ++i) {
+        length += snprintf(line + length, size - length, ",%d", i < record.peak_count ? (int)record.peak_angles[i] : -1);
+    }
+    if (print_map) {
+        for (int angle = 0; angle < DOA_SHM_ANGLES; ++angle) {
+            length += snprintf(line + length, size - length, ",%.4g", record.power_map[angle]);
+        }
+    }
+    line[length++] = '\n';
+    return length;
+}
+
+void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --name NAME     Shared-memory ring to follow (default " << DOA_SHM_DEFAULT_NAME << ")\n"
+              << "  --history N     Start with up to N of the most recent results\n"
+              << "  --map           Append the 360-degree power map to every line\n";
+}
+
+bool parse_options(int argc, char** argv, ListenOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        try {
+            if (arg == "--name" && has_value) {
+                options.name = argv[++i];
+            } else if (arg == "--history" && has_value) {
+                options.history = std::stoull(argv[++i]);
+            } else if (arg == "--map") {
+                options.print_map = true;
+            } else {
+                return false;
+            }
+        } catch (...) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    ListenOptions options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    DoaShmReader reader;
+    std::string error;
+    if (!reader.open(options.name, error)) {
+        std::cerr << "Error: " << error << std::endl;
+        return -1;
+    }
+    const DoaShmHeader& header = reader.header();
+    std::cerr << "Following " << options.name << ": " << header.sample_rate << " Hz, "
+              << header.hop_size << "-sample hops, " << header.slot_count << " results of history." << std::endl;
+
+    // Poll twice per hop: results are never more than half a hop late and the publisher never waits
+    const auto poll_period = std::chrono::microseconds(500000LL * header.hop_size / header.sample_rate);
+
+    printf("hop,time_s,unix_ns,rms,noise_floor,active,angle,power");
+    for (int i = 1; i < DOA_SHM_MAX_PEAKS; ++i) printf(",angle%d", i + 1);
+    if (options.print_map) {
+        for (int angle = 0; angle < DOA_SHM_ANGLES; ++angle) printf(",p%d", angle);
+    }
+    printf("\n");
+
+    // Room for the map at %.4g plus the fixed columns
+    static char line[DOA_SHM_ANGLES * 16 + 256];
+    const uint64_t start = reader.published();
+    uint64_t next = start - std::min<uint64_t>({options.history, start, header.slot_count});
+    uint64_t missed = 0;
+
+    while (true) {
+        const bool closed = reader.writer_closed(); // Checked before draining, so nothing is missed
+        const uint64_t published = reader.published();
+        if (published - next > header.slot_count) {
+            // Fell a whole ring behind (e.g. stdout blocked); resume at the oldest record still there
+            missed += published - header.slot_count - next;
+            next = published - header.slot_count;
+        }
+        for (; next < published; ++next) {
+            int length = 0;
+            bool intact = reader.visit(next, [&](const DoaShmRecord& record) {
+                length = format_record(record, options.print_map, line, sizeof(line));
+            });
+            if (intact) {
+                fwrite(line, 1, length, stdout);
+            } else {
+                ++missed; // Overwritten while we were reading it
+            }
+        }
+        fflush(stdout);
+        if (closed) break;
+        std::this_thread::sleep_for(poll_period);
+    }
+
+    std::cerr << "Publisher closed " << options.name << "." << std::endl;
+    if (missed > 0) std::cerr << missed << " results were overwritten before they could be read." << std::endl;
+    return 0;
+}
@@ -3,6 +3,22 @@
 #define MINIAUDIO_IMPLEMENTATION
 #include "miniaudio.h"
 #include "fft.hpp" //
+#include "uma8_geometry.hpp" // SAMPLE_RATE, CHANNEL_COUNT, MIC_POSITIONS
+#include "doa_engine.hpp"    // FFT_SIZE, HOP_SIZE, the STFT and the beamformer
+#include "decimator.hpp"
+#include "vad.hpp"
+#include "planar_ring.hpp"
+#include "alloc_counter.hpp"
+#include "spsc_queue.hpp"
+#include "thread_util.hpp"
+#include "seqlock.hpp"
+#include "latency_histogram.hpp"
+#include "capture_io.hpp"
+#include "capture_file.hpp"
+#include "capture_compress.hpp"
+#include "capture_writer.hpp"
+#include "doa_shm.hpp"
+#include "result_log.hpp"
 #include <fstream> //For writing possible python file
 
 #include <iostream>
@@ -10,307 +26,1444 @@
 #include <thread>
 #include <chrono>
 #include <mutex>
+#include <atomic>
 #include <string>
 #include <complex>
 #include <numeric>
 #include <algorithm>
 #include <iomanip>
 #include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <cstdarg>
+#include <type_traits>
+#ifdef _WIN32
+#include <windows.h>
+#endif
 
-// --- Configuration ---
-const int SAMPLE_RATE = 48000;
-const int CHANNEL_COUNT = 8;
-const float SPEED_OF_SOUND = 343.0f; // meters per second
-const float MIC_RADIUS = 0.045f;     // 45mm for UMA-8
+// --- Pipeline Configuration ---
+const int FRAME_POOL_SIZE = 16; // Hops in flight between the pipeline stages (power of 2)
+const int MAX_DOA_THREADS = 8;
+const int DEFAULT_DASHBOARD_HZ = 10; // Dashboard refresh rate; independent of the hop rate
+const int HOP_TIMESTAMP_SLOTS = 256; // Capture timestamps kept per hop boundary (> ring length in hops)
+const int OVERRUN_MARGIN_HOPS = 4; // Hops of headroom kept between the reader and the writer
+const double DEFAULT_CORE_WATTS = 1.0; // Power of one busy core, for the VAD saving estimate
+const int DEFAULT_DEADLINE_MS = 50; // --schedule deadline: skip hops captured longer ago than this
+const int RING_SECONDS = 2;        // Capture ring length
+const int RECORD_RING_SECONDS = 8; // Ring length with --record, so the recorder rides out disk stalls
+const int RECORD_POLL_MS = 50;     // How often the recorder drains the ring
 
-// --- TDOA Processing Configuration ---
-const int FFT_SIZE = 1024;
-const int HOP_SIZE = FFT_SIZE / 2;
-const float ENERGY_THRESHOLD = 0.001f; // Adjust based on sensitivity needs
-const double VOICE_FREQ_GAIN = 3.0; // Boosts voice frequencies by 3x
+// --- Type definitions for clarity ---
+using Clock = std::chrono::steady_clock;
 
+// What the STFT stage does with hops that have piled up in the ring while it was stalled
+enum class SchedulePolicy {
+    Batch,    // Catch up on every queued hop in order; resync only if the ring is lapped
+    Newest,   // Jump straight to the newest complete hop, skipping the backlog
+    Deadline, // Catch up in order, but skip hops captured more than the deadline ago
+};
 
-// --- Bandpass Filter Configuration for Human Voice ---
-const float MIN_FREQ = 300.0f;  // Minimum frequency for human voice
-const float MAX_FREQ = 3400.0f; // Maximum frequency for human voice
+bool parse_schedule_policy(const std::string& text, SchedulePolicy& policy) {
+    if (text == "batch") {
+        policy = SchedulePolicy::Batch;
+    } else if (text == "newest") {
+        policy = SchedulePolicy::Newest;
+    } else if (text == "deadline") {
+        policy = SchedulePolicy::Deadline;
+    } else {
+        return false;
+    }
+    return true;
+}
 
-// --- Type definitions for clarity ---
-using Complex = std::complex<double>;
-using ComplexVector = std::vector<Complex>;
-using SteeringVector = std::vector<ComplexVector>; // [mic_index][freq_bin]
+const char* schedule_policy_name(SchedulePolicy policy) {
+    switch (policy) {
+        case SchedulePolicy::Batch: return "batch";
+        case SchedulePolicy::Newest: return "newest";
+        case SchedulePolicy::Deadline: return "deadline";
+    }
+    return "?";
+}
 
 // --- Global Data Structures ---
 struct UserData {
-    std::vector<float> audio_buffer;
-    std::mutex buffer_mutex;
-    size_t head = 0;
+    // Rate and frame sizes of the ring; decimated when --decimate is given
+    const DoaConfig doa;
+
+    // Capture sample format: 16-bit (--s16) or float. Only the matching ring is allocated.
+    const bool s16;
+
+    // Anti-alias decimator run by the capture callback, and its preallocated output block
+    Decimator decimator;
+    std::vector<float> decimated;
+    std::vector<float> widened;       // 16-bit input converted for the decimator
+    std::vector<int16_t> requantized; // Decimator output converted back for the 16-bit ring
+
+    // Per-channel capture ring, filled directly by the capture callback
+    PlanarRing ring;        // RING_SECONDS of audio (RECORD_RING_SECONDS with --record)
+    PlanarRingS16 ring_s16; // Same, in the device's 16-bit format
+
+    // Arrival time (steady clock, ns) of the block that completed hop h, at [h % HOP_TIMESTAMP_SLOTS]
+    std::atomic<int64_t> hop_capture_ns[HOP_TIMESTAMP_SLOTS] = {};
+
+    // Mean square of the centre mic over the raw samples of hop h, at [h % HOP_TIMESTAMP_SLOTS],
+    // accumulated by the capture side so the VAD can judge a hop before any framing work
+    std::atomic<float> hop_energy[HOP_TIMESTAMP_SLOTS] = {};
+    double hop_energy_sum = 0.0; // Capture side only: centre mic energy of the hop in progress
+
+    // Raised by the capture callback once a full hop has been written. Never blocks the callback;
+    // the STFT stage is its only waiter.
+    RealtimeWakeSignal hop_ready;
+
+    // Whether the audio library's capture thread got a real-time policy: -1 until the first callback
+    std::atomic<int> capture_thread_realtime{-1};
+
+    UserData(const DoaConfig& config, bool s16_capture, int ring_seconds)
+        : doa(config),
+          s16(s16_capture),
+          decimator(CHANNEL_COUNT, config.decimation),
+          decimated(decimator.max_output_frames(Decimator::BLOCK_FRAMES) * CHANNEL_COUNT),
+          widened(s16_capture && config.decimation > 1 ? Decimator::BLOCK_FRAMES * CHANNEL_COUNT : 0),
+          requantized(s16_capture && config.decimation > 1 ? decimated.size() : 0),
+          ring(CHANNEL_COUNT, s16_capture ? 0 : config.sample_rate * ring_seconds, config.fft_size),
+          ring_s16(CHANNEL_COUNT, s16_capture ? config.sample_rate * ring_seconds : 0, config.fft_size) {}
+
+    uint64_t frames_written() const { return s16 ? ring_s16.frames_written() : ring.frames_written(); }
+    size_t ring_capacity() const { return s16 ? ring_s16.capacity() : ring.capacity(); }
 };
 
-const std::vector<std::pair<float, float>> MIC_POSITIONS = {
-    {0.0f, 0.0f}, //Mic 0 (center) - Not used in DOA
-    {MIC_RADIUS * cosf(0.0f * M_PI / 180.0f), MIC_RADIUS * sinf(0.0f * M_PI / 180.0f)},   // Mic 1 (0 deg)
-    {MIC_RADIUS * cosf(60.0f * M_PI / 180.0f), MIC_RADIUS * sinf(60.0f * M_PI / 180.0f)},  // Mic 2 (60 deg)
-    {MIC_RADIUS * cosf(120.0f * M_PI / 180.0f), MIC_RADIUS * sinf(120.0f * M_PI / 180.0f)},// Mic 3 (120 deg)
-    {MIC_RADIUS * cosf(180.0f * M_PI / 180.0f), MIC_RADIUS * sinf(180.0f * M_PI / 180.0f)},// Mic 4 (180 deg)
-    {MIC_RADIUS * cosf(240.0f * M_PI / 180.0f), MIC_RADIUS * sinf(240.0f * M_PI / 180.0f)},// Mic 5 (240 deg)
-    {MIC_RADIUS * cosf(300.0f * M_PI / 180.0f), MIC_RADIUS * sinf(300.0f * M_PI / 180.0f)},// Mic 6 (300 deg)
-    {0.0f, 0.0f}, //Mic 7 (spare)
+// One hop travelling through the pipeline. Frames live in a fixed pool and are handed between
+// stages by index, so no stage allocates.
+struct Frame {
+    uint64_t sequence = 0;
+    uint64_t frame_start = 0;        // Absolute ring index of the first sample
+    Clock::time_point captured_at;   // When the hop's last block arrived from the device
+    Clock::time_point dequeued_at;   // When the STFT stage picked the hop up
+    Clock::time_point fft_done_at;
+    Clock::time_point doa_done_at;
+    float rms_energy = 0.0f;
+    float noise_floor = 0.0f;        // VAD noise floor (RMS) when the hop was judged
+    bool active = false;             // VAD verdict: the FFTs are valid and the beamformer should run
+    Clock::time_point doa_started_at;
+    std::vector<ComplexVector> channel_ffts; // [mic][bin]
+    int final_angle = -1;
+    float beam_energy = 0.0f;
+    uint64_t allocations = 0;        // Heap allocations the stages made for this hop
+    uint32_t lag_hops = 0;           // Complete hops already waiting behind this one when it was dequeued
+    std::vector<float> power_map;    // Beam power per degree, filled only for --shm
+
+    explicit Frame(int fft_size) : channel_ffts(CHANNEL_COUNT, ComplexVector(fft_size)), power_map(DOA_SHM_ANGLES) {}
 };
 
-// Pre-computes the phase shifts for all angles, mics, and frequencies
-std::vector<SteeringVector> precompute_steering_vectors() {
-    std::vector<SteeringVector> all_steering_vectors(360);
-
-    for (int angle = 0; angle < 360; ++angle) {
-        all_steering_vectors[angle].resize(CHANNEL_COUNT);
-        // Use double for all calculations
-        double angle_rad = angle * M_PI / 180.0;
-
-        for (int i = 1; i <= 6; ++i) { // Only for the 6 outer mics
-            all_steering_vectors[angle][i].resize(FFT_SIZE / 2 + 1);
-            // Ensure MIC_POSITIONS values are treated as double
-            double mic_x = MIC_POSITIONS[i].first;
-            double mic_y = MIC_POSITIONS[i].second;
-
-            // Project mic position onto the sound wave direction vector
-            double projection = mic_x * cos(angle_rad) + mic_y * sin(angle_rad);
-            double time_delay = projection / SPEED_OF_SOUND;
-
-            for (int k = 0; k <= FFT_SIZE / 2; ++k) {
-                double freq = (double)k * SAMPLE_RATE / FFT_SIZE;
-                double omega = 2.0 * M_PI * freq;
-                // The steering vector is the complex exponential representing the phase shift
-                // This line will now work correctly
-                all_steering_vectors[angle][i][k] = std::exp(Complex(0.0, 1.0) * omega * time_delay);
-            }
-        }
-    }
-    return all_steering_vectors;
-}
+// Room for the whole pool plus the end-of-stream marker, so pushes never fail
+using FrameQueue = SpscQueue<uint32_t, FRAME_POOL_SIZE * 2>;
+const uint32_t END_OF_STREAM = 0xFFFFFFFFu; // Queued after the last frame of a replay
 
-// UPDATED ALGORITHM: Frequency-Domain Beamforming with Voice Amplification
-std::pair<int, double> calculate_doa_fft(
-    std::vector<ComplexVector>& channel_ffts,
-    const std::vector<SteeringVector>& all_steering_vectors) {
+// Command line options for the pipeline. CPU indices of -1 leave the thread unpinned.
+struct PipelineOptions {
+    int doa_threads = 1;
+    int stft_cpu = -1;
+    std::vector<int> doa_cpus;
+    int publish_cpu = -1;
+    int dashboard_hz = DEFAULT_DASHBOARD_HZ;
+    int dashboard_cpu = -1;
+    std::string replay_path;  // Replay a recorded capture instead of opening the device
+    bool replay_fast = false; // Feed the replay as fast as the pipeline accepts it
+    bool quiet = false;       // Replay: skip the per-hop result lines
+    int decimation = 1;       // Decimate the capture by 3 (16 kHz) or 4 (12 kHz) before framing
+    bool s16 = false;         // Capture 16-bit samples instead of float
+    VadMode vad_mode = VadMode::Adaptive;
+    double core_watts = DEFAULT_CORE_WATTS;
+    SchedulePolicy schedule = SchedulePolicy::Batch;
+    int deadline_ms = DEFAULT_DEADLINE_MS;
+    int doa_batch = MAX_DOA_BATCH; // Most queued hops a DOA worker beamforms in one pass
+    int rt_priority = 0;           // SCHED_FIFO priority for the processing stages; 0 leaves them normal
+    bool lock_memory = false;      // mlockall and prefault the ring, frames and steering tables
+    std::string shm_name;          // Publish every result into this shared-memory ring
+    std::string record_path;       // Also stream the raw capture to this file (format from the extension)
+    std::string log_path;          // Log every result to this file ("-" for stdout) instead of the dashboard
+    ResultLogFormat log_format = ResultLogFormat::JsonLines;
+};
 
-    double max_power = -1.0;
-    int best_angle = -1;
+// Latest published result. The publish stage stores it into a seqlock after every hop and the
+// dashboard thread samples it at its own pace, so terminal I/O never blocks the pipeline.
+struct DashboardSnapshot {
+    uint64_t sequence;
+    float rms_energy;
+    float noise_floor;
+    bool active;
+    int final_angle;
+    float beam_energy;
+    double latency_ms;
+    uint64_t dropped_hops;
+    uint64_t ring_overruns;
+    uint64_t allocations;
+    double silent_fraction;
+    double saved_watts;
+    uint32_t lag_hops;
+    uint32_t max_lag_hops;
+    uint64_t skipped_hops;
+};
 
-    // Define the frequency bins for our bandpass filter
-    const int min_bin = static_cast<int>(MIN_FREQ * FFT_SIZE / SAMPLE_RATE);
-    const int max_bin = static_cast<int>(MAX_FREQ * FFT_SIZE / SAMPLE_RATE);
+// Latency histograms kept per pipeline stage, plus the end-to-end total
+enum LatencyStage {
+    STAGE_CAPTURE_TO_DEQUEUE,
+    STAGE_DEQUEUE_TO_FFT,
+    STAGE_FFT_TO_DOA,
+    STAGE_DOA_TO_PUBLISH,
+    STAGE_END_TO_END,
+    STAGE_COUNT
+};
+const char* const STAGE_NAMES[STAGE_COUNT] = {
+    "capture -> dequeue", "dequeue -> FFT done", "FFT -> DOA done", "DOA -> publish", "capture -> publish",
+};
 
-    // Apply bandpass filter AND amplify voice frequencies
-    for (auto& fft_vec : channel_ffts) {
-        for (int k = 0; k < fft_vec.size(); ++k) {
-            if (k >= min_bin && k <= max_bin) {
-                // Apply gain to the frequencies we want
-                fft_vec[k] *= VOICE_FREQ_GAIN;
-            } else {
-                // Zero out all other frequencies
-                fft_vec[k] = 0;
-            }
-        }
-    }
+// Stages: capture callback -> STFT -> DOA worker(s) -> publish. The STFT stage deals hops to the
+// DOA workers round-robin and the publisher collects them in the same order, so every queue stays
+// single-producer / single-consumer and results come out in capture order.
+struct Pipeline {
+    std::vector<Frame> frames;                  // FRAME_POOL_SIZE frames, sized in main for the FFT in use
+    FrameQueue free_frames;                     // publish -> STFT
+    FrameQueue stft_to_doa[MAX_DOA_THREADS];
+    FrameQueue doa_to_publish[MAX_DOA_THREADS];
+    WakeSignal doa_wake[MAX_DOA_THREADS];
+    WakeSignal publish_wake;
+    int doa_threads = 1;
+    int doa_batch = MAX_DOA_BATCH;
 
-    // --- The rest of the function remains the same ---
-    for (int angle = 0; angle < 360; ++angle) {
-        ComplexVector summed_spectrum(FFT_SIZE / 2 + 1, {0.0, 0.0});
+    Seqlock<DashboardSnapshot> latest;          // publish -> dashboard
+    WakeSignal dashboard_wake;                  // Only used to cut the dashboard's sleep short on exit
 
-        for (int i = 1; i <= 6; ++i) { // Only use the 6 outer mics
-            for (int k = min_bin; k <= max_bin; ++k) {
-                summed_spectrum[k] += channel_ffts[i][k] * std::conj(all_steering_vectors[angle][i][k]);
-            }
-        }
+    std::atomic<bool> quit_requested{false};
+    std::atomic<uint64_t> dropped_hops{0};      // Hops skipped because every frame was in flight
+    std::atomic<uint64_t> ring_overruns{0};     // Times the reader fell a full ring behind the capture
+    std::atomic<uint64_t> skipped_hops{0};      // Hops passed over by the schedule policy
+    std::atomic<uint32_t> max_lag_hops{0};      // Deepest backlog seen by the STFT stage
+    SchedulePolicy schedule = SchedulePolicy::Batch;
+    Clock::duration deadline = std::chrono::milliseconds(DEFAULT_DEADLINE_MS);
+    bool wait_for_frames = false; // STFT stage waits for a free frame rather than drop the hop
+    int rt_priority = 0;
 
-        double current_power = 0.0;
-        for (int k = min_bin; k <= max_bin; ++k) {
-            current_power += std::norm(summed_spectrum[k]);
-        }
+    // Thread and memory settings that were requested but could not be applied
+    std::mutex setup_mutex;
+    std::vector<std::string> setup_failures;
+    LatencyHistogram stage_latency[STAGE_COUNT];
+    std::atomic<bool> report_requested{false};  // Set by the input thread, printed by the dashboard
 
-        if (current_power > max_power) {
-            max_power = current_power;
-            best_angle = angle;
-        }
+    // Replay support. In lossless mode the STFT stage waits for a free frame instead of dropping
+    // the hop, and the replay source waits for ring space instead of overrunning the reader.
+    bool lossless = false;
+    bool print_results = false;
+    bool headless = false;                      // No dashboard thread (--log)
+    DoaShmWriter* shm = nullptr;                // Result ring for other processes (--shm)
+    ResultLogWriter* result_log = nullptr;      // Per-hop log (--log); replaces the dashboard
+
+    // Raw audio recording (--record), written and closed by the recorder thread
+    RotatingCaptureWriter* record_writer = nullptr;
+    std::atomic<uint64_t> recorded_frames{0};
+    std::atomic<uint64_t> record_lost_frames{0}; // Overwritten before they were saved; written as silence
+    std::atomic<bool> record_failed{false};
+    std::atomic<uint64_t> stft_position{0};     // Oldest ring frame the STFT stage still needs
+    std::atomic<uint64_t> record_position{0};   // Oldest ring frame the recorder still needs
+    WakeSignal source_wake;                     // STFT -> replay source: ring space was freed
+    std::atomic<bool> source_finished{false};   // No more audio will be written to the ring
+    std::atomic<uint64_t> hops_published{0};
+
+    // VAD accounting, written by the publish stage. Work is the STFT plus DOA compute time of a hop.
+    VadMode vad_mode = VadMode::Adaptive;
+    double core_watts = DEFAULT_CORE_WATTS;
+    double hop_seconds = (double)HOP_SIZE / SAMPLE_RATE; // Audio time per hop
+    std::atomic<uint64_t> active_hops{0};
+    std::atomic<uint64_t> silent_hops{0};
+    std::atomic<int64_t> active_work_ns{0};
+    std::atomic<int64_t> silent_work_ns{0};
+};
+
+// Power the VAD saves while keeping up with real time: every silent hop would otherwise have cost
+// as much work as an average active hop, and that compute time would have kept a core busy at
+// core_watts. Measured against audio time, so it also holds for a fast replay.
+double vad_saved_watts(const Pipeline& pipeline, double* saved_cpu_s = nullptr) {
+    const uint64_t active = pipeline.active_hops.load(std::memory_order_relaxed);
+    const uint64_t silent = pipeline.silent_hops.load(std::memory_order_relaxed);
+    double saved_s = 0.0;
+    if (active > 0 && silent > 0) {
+        const double active_ns = (double)pipeline.active_work_ns.load(std::memory_order_relaxed) / active;
+        const double silent_ns = (double)pipeline.silent_work_ns.load(std::memory_order_relaxed) / silent;
+        saved_s = std::max(0.0, active_ns - silent_ns) * silent * 1e-9;
     }
-    return {best_angle, max_power};
+    if (saved_cpu_s) *saved_cpu_s = saved_s;
+    const double audio_s = (active + silent) * pipeline.hop_seconds;
+    return audio_s > 0.0 ? saved_s / audio_s * pipeline.core_watts : 0.0;
 }
 
-// Function to print the debug dashboard (no changes needed)
-void print_debug_dashboard(float rms_energy, int final_angle, float beam_energy) {
-     // Clear the screen in a portable way
-    #ifdef _WIN32
-        system("cls");
-    #else
-        // Move cursor to top-left corner and clear screen using ANSI codes for Linux/macOS
-        std::cout << "\033[2J\033[H";
-    #endif
-    
-    std::cout << "===== UMA-8 TDOA Real-Time Debug Dashboard (Optimized) =====\n";
-    std::cout << "Listening for human voice (" << MIN_FREQ << "-" << MAX_FREQ << " Hz)...\n";
-    std::cout << "------------------------------------------------\n";
-    
-    std::cout << "RMS Energy: " << std::fixed << std::setprecision(4) << rms_energy 
-              << " (Threshold: " << ENERGY_THRESHOLD << ")" << (rms_energy >= ENERGY_THRESHOLD ? " [SOUND DETECTED]" : " [SILENT]")
-              << "       \n";
-    
-    std::cout << "------------------------------------------------\n";
-    std::cout << "Final Estimated Angle: " << (final_angle >= 0 ? std::to_string(final_angle) : "N/A") << " degrees            \n";
-    std::cout << "Beamformer Power:      " << (final_angle >= 0 ? std::to_string(beam_energy) : "N/A") << " (Higher is better)\n";
+// --- Dashboard rendering ---
+// The dashboard is a fixed grid of space-padded lines. Each refresh formats a new grid, compares
+// it with what is on screen and rewrites only the cells that changed.
+const int DASHBOARD_ROWS = 14;
+const int DASHBOARD_COLS = 64;
+using DashboardGrid = char[DASHBOARD_ROWS][DASHBOARD_COLS];
+
+// Formats one dashboard line into `row`, padding it with spaces to the full width
+void set_dashboard_row(DashboardGrid& grid, int row, const char* format, ...) {
+    char line[DASHBOARD_COLS + 1];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    n = std::max(0, std::min(n, DASHBOARD_COLS));
+    std::memcpy(grid[row], line, n);
+    std::memset(grid[row] + n, ' ', DASHBOARD_COLS - n);
+}
+
+void format_dashboard(const DashboardSnapshot& snap, bool have_result, DashboardGrid& grid) {
+    set_dashboard_row(grid, 0, "===== UMA-8 TDOA Real-Time Debug Dashboard (Optimized) =====");
+    set_dashboard_row(grid, 1, "Listening for human voice (%.0f-%.0f Hz)...", MIN_FREQ, MAX_FREQ);
+    set_dashboard_row(grid, 2, "------------------------------------------------");
+    if (have_result && snap.noise_floor > 0.0f) {
+        set_dashboard_row(grid, 3, "RMS Energy: %.4f (Noise floor: %.4f) %s", snap.rms_energy, snap.noise_floor,
+                          snap.active ? "[SOUND DETECTED]" : "[SILENT]");
+    } else if (have_result) {
+        set_dashboard_row(grid, 3, "RMS Energy: %.4f (Threshold: %.4f) %s", snap.rms_energy, ENERGY_THRESHOLD,
+                          snap.active ? "[SOUND DETECTED]" : "[SILENT]");
+    } else {
+        set_dashboard_row(grid, 3, "RMS Energy: waiting for audio...");
+    }
+    set_dashboard_row(grid, 4, "------------------------------------------------");
+    if (have_result && snap.final_angle >= 0) {
+        set_dashboard_row(grid, 5, "Final Estimated Angle: %d degrees", snap.final_angle);
+        set_dashboard_row(grid, 6, "Beamformer Power:      %.4f (Higher is better)", snap.beam_energy);
+    } else {
+        set_dashboard_row(grid, 5, "Final Estimated Angle: N/A degrees");
+        set_dashboard_row(grid, 6, "Beamformer Power:      N/A (Higher is better)");
+    }
+    set_dashboard_row(grid, 7, "Latency: %.3f ms (Dropped hops: %llu, Ring overruns: %llu)",
+                      have_result ? snap.latency_ms : 0.0, (unsigned long long)snap.dropped_hops,
+                      (unsigned long long)snap.ring_overruns);
+    if (heap_allocation_counting_enabled()) {
+        set_dashboard_row(grid, 8, "Heap allocations (last hop): %llu", (unsigned long long)snap.allocations);
+    } else {
+        set_dashboard_row(grid, 8, "");
+    }
+    set_dashboard_row(grid, 9, "Silent hops skipped: %.1f%% (saving ~%.0f mW)", 100.0 * snap.silent_fraction,
+                      snap.saved_watts * 1000.0);
+    set_dashboard_row(grid, 10, " 0--------------------180--------------------359");
 
     // ASCII Visualizer
-    std::string compass_line(45, ' ');
-    if (final_angle >= 0) {
-        int pos = static_cast<int>(round((final_angle / 360.0) * 44.0));
+    char compass_line[46];
+    std::memset(compass_line, ' ', 45);
+    compass_line[45] = '\0';
+    if (have_result && snap.final_angle >= 0) {
+        int pos = static_cast<int>(round((snap.final_angle / 360.0) * 44.0));
         compass_line[pos] = 'V';
     }
-    std::cout << "\n 0" << std::string(20, '-') << "180" << std::string(20, '-') << "359\n";
-    std::cout << "[" << compass_line << "]\n";
-    
-    std::cout << "\nPress Enter to quit.\n" << std::flush;
+    set_dashboard_row(grid, 11, "[%s]", compass_line);
+    set_dashboard_row(grid, 12, "Backlog: %u hops (max %u), %llu skipped by schedule", snap.lag_hops,
+                      snap.max_lag_hops, (unsigned long long)snap.skipped_hops);
+    set_dashboard_row(grid, 13, "Press Enter to quit, or type s + Enter for latency stats.");
 }
 
-// Saves the captured multi-channel audio frame to a CSV file
+// Writes the cells of `next` that differ from `shown` using ANSI cursor positioning, then
+// remembers `next` as the screen contents
+void redraw_changed_cells(const DashboardGrid& next, DashboardGrid& shown) {
+    std::string out;
+    for (int row = 0; row < DASHBOARD_ROWS; ++row) {
+        int first = 0;
+        while (first < DASHBOARD_COLS && next[row][first] == shown[row][first]) ++first;
+        if (first == DASHBOARD_COLS) continue;
+        int last = DASHBOARD_COLS - 1;
+        while (next[row][last] == shown[row][last]) --last;
+
+        char move[24];
+        snprintf(move, sizeof(move), "\033[%d;%dH", row + 1, first + 1);
+        out += move;
+        out.append(next[row] + first, last - first + 1);
+        std::memcpy(shown[row] + first, next[row] + first, last - first + 1);
+    }
+    if (!out.empty()) {
+        out += "\033[" + std::to_string(DASHBOARD_ROWS + 1) + ";1H"; // Park the cursor below the grid
+        std::cout << out << std::flush;
+    }
+}
+
+// Prints p50/p99/max for every stage along with the drop counters
+void print_latency_report(const Pipeline& pipeline, std::ostream& out) {
+    char line[128];
+    snprintf(line, sizeof(line), "%-22s %10s %10s %10s %10s\n", "Stage", "Hops", "p50 (ms)", "p99 (ms)", "max (ms)");
+    out << line;
+    for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+        const LatencyHistogram& h = pipeline.stage_latency[stage];
+        snprintf(line, sizeof(line), "%-22s %10llu %10.3f %10.3f %10.3f\n", STAGE_NAMES[stage],
+                 (unsigned long long)h.count(), h.percentile(50) / 1e6, h.percentile(99) / 1e6, h.max() / 1e6);
+        out << line;
+    }
+    out << "Dropped hops: " << pipeline.dropped_hops.load() << ", Ring overruns: " << pipeline.ring_overruns.load() << "\n";
+    out << "Schedule (" << schedule_policy_name(pipeline.schedule) << "): " << pipeline.skipped_hops.load()
+        << " hops skipped, max backlog " << pipeline.max_lag_hops.load() << " hops\n";
+
+    const uint64_t active = pipeline.active_hops.load();
+    const uint64_t silent = pipeline.silent_hops.load();
+    double saved_cpu_s = 0.0;
+    const double saved_watts = vad_saved_watts(pipeline, &saved_cpu_s);
+    snprintf(line, sizeof(line), "VAD (%s): %llu of %llu hops silent (%.1f%%)\n", vad_mode_name(pipeline.vad_mode),
+             (unsigned long long)silent, (unsigned long long)(active + silent),
+             active + silent > 0 ? 100.0 * silent / (active + silent) : 0.0);
+    out << line;
+    snprintf(line, sizeof(line), "Work per hop: active %.3f ms, silent %.3f ms\n",
+             active > 0 ? pipeline.active_work_ns.load() / 1e6 / active : 0.0,
+             silent > 0 ? pipeline.silent_work_ns.load() / 1e6 / silent : 0.0);
+    out << line;
+    snprintf(line, sizeof(line), "Saved %.2f s of CPU time, ~%.0f mW at %.1f W per busy core\n", saved_cpu_s,
+             saved_watts * 1000.0, pipeline.core_watts);
+    out << line;
+}
+
+// Prepares the terminal for ANSI cursor control and clears it once
+void init_dashboard_terminal() {
+    #ifdef _WIN32
+        // Enable ANSI escape handling in the Windows console instead of spawning "cls" per redraw
+        HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+        DWORD mode = 0;
+        if (GetConsoleMode(console, &mode)) {
+            SetConsoleMode(console, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+        }
+    #endif
+    std::cout << "\033[2J\033[H" << std::flush;
+}
+
+// Saves the captured multi-channel audio frame to a CSV file, formatted with std::to_chars into one
+// buffer and written with a single write
 void save_capture_to_csv(const std::vector<std::vector<double>>& channels) {
     static int capture_count = 0; // Static counter to create unique filenames
     std::string filename = "capture_" + std::to_string(capture_count++) + ".csv";
-    
-    std::ofstream csv_file(filename);
-    if (!csv_file.is_open()) {
+
+    std::string text;
+    for (int i = 0; i < CHANNEL_COUNT; ++i) {
+        text += "Mic" + std::to_string(i) + (i == CHANNEL_COUNT - 1 ? "\n" : ",");
+    }
+    const double* planar[CHANNEL_COUNT];
+    for (int j = 0; j < CHANNEL_COUNT; ++j) planar[j] = channels[j].data();
+    append_csv_rows(planar, CHANNEL_COUNT, FFT_SIZE, text);
+
+    std::FILE* csv_file = std::fopen(filename.c_str(), "wb");
+    if (csv_file == nullptr) {
         std::cerr << "Error: Could not open file " << filename << " for writing." << std::endl;
         return;
     }
+    const bool written = std::fwrite(text.data(), 1, text.size(), csv_file) == text.size();
+    if (std::fclose(csv_file) != 0 || !written) {
+        std::cerr << "Error: Could not write " << filename << "." << std::endl;
+        return;
+    }
 
-    // Write header
-    for (int i = 0; i < CHANNEL_COUNT; ++i) {
-        csv_file << "Mic" << i << (i == CHANNEL_COUNT - 1 ? "" : ",");
+    std::cout << "Saved capture to " << filename << std::endl;
+}
+
+static inline float sample_value(float sample) { return sample; }
+static inline float sample_value(int16_t sample) { return sample * S16_SCALE; }
+
+// Appends frames at the ring's rate, stamping every hop they complete with the block's arrival
+// time first (the ring's release store publishes the stamps). Returns true if a hop completed.
+template <typename Sample>
+bool append_to_ring(UserData* pUserData, BasicPlanarRing<Sample>& ring, const Sample* frames, size_t frameCount,
+                    int64_t arrival_ns) {
+    const uint64_t hop_size = pUserData->doa.hop_size;
+    const uint64_t written = ring.frames_written();
+    const uint64_t first_hop = written / hop_size + 1;
+    const uint64_t last_hop = (written + frameCount) / hop_size;
+    for (uint64_t hop = first_hop; hop <= last_hop; ++hop) {
+        pUserData->hop_capture_ns[hop % HOP_TIMESTAMP_SLOTS].store(arrival_ns, std::memory_order_relaxed);
     }
-    csv_file << "\n";
 
-    // Write data rows (sample by sample)
-    for (int i = 0; i < FFT_SIZE; ++i) {
-        for (int j = 0; j < CHANNEL_COUNT; ++j) {
-            csv_file << channels[j][i] << (j == CHANNEL_COUNT - 1 ? "" : ",");
+    // Centre mic energy per hop, straight from the raw interleaved frames
+    double sum = pUserData->hop_energy_sum;
+    for (size_t i = 0; i < frameCount; ++i) {
+        const float sample = sample_value(frames[i * CHANNEL_COUNT]);
+        sum += sample * sample;
+        if ((written + i + 1) % hop_size == 0) {
+            const uint64_t hop = (written + i + 1) / hop_size;
+            pUserData->hop_energy[hop % HOP_TIMESTAMP_SLOTS].store((float)(sum / hop_size), std::memory_order_relaxed);
+            sum = 0.0;
         }
-        csv_file << "\n";
     }
+    pUserData->hop_energy_sum = sum;
+    ring.write_interleaved(frames, frameCount);
+    return last_hop >= first_hop;
+}
 
-    std::cout << "Saved capture to " << filename << std::endl;
+// Feeds one block of interleaved capture into the pipeline. Called from the device callback, or
+// from the replay source when running against a recorded capture. With decimation the block is
+// filtered in pieces through the preallocated output buffer, so nothing is allocated here.
+// pInput holds float or, with --s16, 16-bit frames.
+void ingest_block(UserData* pUserData, const void* pInput, ma_uint32 frameCount) {
+    const int64_t arrival_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+
+    bool hop_completed = false;
+    if (pUserData->s16) {
+        const int16_t* pInputS16 = (const int16_t*)pInput;
+        if (pUserData->doa.decimation == 1) {
+            hop_completed = append_to_ring(pUserData, pUserData->ring_s16, pInputS16, frameCount, arrival_ns);
+        } else {
+            // The decimator filters in float; the ring stays 16-bit
+            for (size_t done = 0; done < frameCount; ) {
+                const size_t n = std::min<size_t>(frameCount - done, Decimator::BLOCK_FRAMES);
+                convert_s16_to_f32(pInputS16 + done * CHANNEL_COUNT, pUserData->widened.data(), n * CHANNEL_COUNT);
+                const size_t produced = pUserData->decimator.process(pUserData->widened.data(), n, pUserData->decimated.data());
+                convert_f32_to_s16(pUserData->decimated.data(), pUserData->requantized.data(), produced * CHANNEL_COUNT);
+                hop_completed |= append_to_ring(pUserData, pUserData->ring_s16, pUserData->requantized.data(), produced, arrival_ns);
+                done += n;
+            }
+        }
+    } else if (pUserData->doa.decimation == 1) {
+        hop_completed = append_to_ring(pUserData, pUserData->ring, (const float*)pInput, frameCount, arrival_ns);
+    } else {
+        const float* pInputF32 = (const float*)pInput;
+        for (size_t done = 0; done < frameCount; ) {
+            const size_t n = std::min<size_t>(frameCount - done, Decimator::BLOCK_FRAMES);
+            const size_t produced = pUserData->decimator.process(pInputF32 + done * CHANNEL_COUNT, n, pUserData->decimated.data());
+            hop_completed |= append_to_ring(pUserData, pUserData->ring, pUserData->decimated.data(), produced, arrival_ns);
+            done += n;
+        }
+    }
+
+    // Only wake the STFT stage when there is a full hop for it to consume
+    if (hop_completed) pUserData->hop_ready.notify();
 }
 
-// data_callback remains the same
+// Capture callback: de-interleaves each block straight into the planar ring
 void data_callback(ma_device* pDevice, void* pOutput, const void* pInput, ma_uint32 frameCount) {
     (void)pOutput;
     UserData* pUserData = (UserData*)pDevice->pUserData;
     if (pUserData == nullptr) return;
-    const float* pInputF32 = (const float*)pInput;
-    
-    std::lock_guard<std::mutex> lock(pUserData->buffer_mutex);
-    for (ma_uint32 i = 0; i < frameCount * CHANNEL_COUNT; ++i) {
-        pUserData->audio_buffer[pUserData->head] = pInputF32[i];
-        pUserData->head = (pUserData->head + 1) % pUserData->audio_buffer.size();
+    if (pUserData->capture_thread_realtime.load(std::memory_order_relaxed) < 0) {
+        pUserData->capture_thread_realtime.store(current_thread_is_realtime() ? 1 : 0, std::memory_order_relaxed);
+    }
+    ingest_block(pUserData, pInput, frameCount);
+}
+
+// Plays a recorded capture into the pipeline one hop at a time, either paced to the wall clock
+// (behaving exactly like the device) or as fast as the pipeline drains the ring. `interleaved`
+// holds total_frames frames in the capture format (float, or 16-bit with --s16).
+void replay_source(UserData* pUserData, Pipeline* pipeline, const void* interleaved, uint64_t total_frames, bool fast) {
+    const size_t frame_bytes = CHANNEL_COUNT * (pUserData->s16 ? sizeof(int16_t) : sizeof(float));
+    const Clock::time_point start = Clock::now();
+    const DoaConfig& doa = pUserData->doa;
+    const uint64_t overrun_margin = (uint64_t)doa.hop_size * OVERRUN_MARGIN_HOPS;
+    uint64_t fed = 0;
+
+    while (fed < total_frames && !pipeline->quit_requested) {
+        const ma_uint32 block = (ma_uint32)std::min<uint64_t>(doa.hop_size * doa.decimation, total_frames - fed);
+        if (fast) {
+            // Ring frames this block can add, after decimation
+            const uint64_t incoming = pUserData->decimator.max_output_frames(block);
+            pipeline->source_wake.wait([&] {
+                uint64_t oldest_needed = pipeline->stft_position;
+                if (pipeline->record_writer != nullptr) oldest_needed = std::min<uint64_t>(oldest_needed, pipeline->record_position);
+                return pipeline->quit_requested ||
+                       pUserData->frames_written() + incoming + overrun_margin <= oldest_needed + pUserData->ring_capacity();
+            });
+        } else {
+            std::this_thread::sleep_until(start + std::chrono::microseconds((fed + block) * 1000000 / SAMPLE_RATE));
+        }
+        ingest_block(pUserData, (const char*)interleaved + fed * frame_bytes, block);
+        fed += block;
+    }
+    pipeline->source_finished = true;
+    pUserData->hop_ready.notify();
+}
+
+// Blocks on stdin so no stage ever has to poll it. "s" asks the dashboard for a latency report;
+// anything else (or closing stdin) requests shutdown and wakes every stage.
+void input_thread_func(UserData* pUserData, Pipeline* pipeline) {
+    std::string line;
+    while (std::getline(std::cin, line) && line == "s") {
+        if (pipeline->headless) {
+            print_latency_report(*pipeline, std::cerr); // No dashboard to print it
+            continue;
+        }
+        pipeline->report_requested = true;
+        pipeline->dashboard_wake.notify_all();
+    }
+    pipeline->quit_requested = true;
+    pUserData->hop_ready.notify();
+    for (int w = 0; w < pipeline->doa_threads; ++w) pipeline->doa_wake[w].notify_all();
+    pipeline->publish_wake.notify_all();
+    pipeline->dashboard_wake.notify_all();
+}
+
+// Warns about a setting that could not be applied, and keeps it for the final report (the
+// dashboard clears the screen, so a startup warning alone would be lost)
+void report_setup_failure(Pipeline* pipeline, const std::string& message) {
+    std::cerr << "Warning: " << message << std::endl;
+    std::lock_guard<std::mutex> lock(pipeline->setup_mutex);
+    pipeline->setup_failures.push_back(message);
+}
+
+// Pins the calling stage thread if a CPU was requested and, for processing stages, raises it to
+// SCHED_FIFO if --rt-priority was given, reporting any failure
+void setup_stage_thread(Pipeline* pipeline, const char* stage_name, int cpu, bool realtime) {
+    std::string error;
+    if (cpu >= 0 && !pin_current_thread(cpu, error)) {
+        report_setup_failure(pipeline, std::string("could not pin ") + stage_name + " thread: " + error);
+    }
+    if (realtime && pipeline->rt_priority > 0 && !set_current_thread_realtime(pipeline->rt_priority, error)) {
+        report_setup_failure(pipeline, std::string("could not make ") + stage_name + " thread real-time: " + error);
     }
 }
 
+// Touches every page the processing threads use, so the first hops don't page-fault. Returns the
+// number of bytes touched.
+size_t prefault_working_set(UserData& userData, Pipeline& pipeline, std::vector<SteeringVector>& all_steering_vectors) {
+    size_t bytes = 0;
+    auto touch = [&](void* data, size_t size) {
+        prefault_pages(data, size);
+        bytes += size;
+    };
+    for (int c = 0; c < CHANNEL_COUNT; ++c) {
+        touch(userData.ring.channel_storage(c), userData.ring.storage_frames() * sizeof(float));
+        touch(userData.ring_s16.channel_storage(c), userData.ring_s16.storage_frames() * sizeof(int16_t));
+    }
+    for (SteeringVector& angle : all_steering_vectors) {
+        for (ComplexVector& mic : angle) touch(mic.data(), mic.size() * sizeof(Complex));
+    }
+    for (Frame& frame : pipeline.frames) {
+        for (ComplexVector& fft : frame.channel_ffts) touch(fft.data(), fft.size() * sizeof(Complex));
+    }
+    return bytes;
+}
+
+// Reports how many results reached the --log file (nothing without --log)
+void print_result_log_summary(const Pipeline& pipeline, std::ostream& out) {
+    if (pipeline.result_log == nullptr) return;
+    out << "Result log: " << pipeline.result_log->records_written() << " hops written, "
+        << pipeline.result_log->records_dropped() << " dropped (writer too far behind)";
+    if (pipeline.result_log->write_failed()) out << ", WRITE FAILED (disk full or pipe closed?)";
+    out << "\n";
+}
+
+// Reports how much audio --record saved and how much was lost to a slow disk (nothing without --record)
+void print_record_summary(const Pipeline& pipeline, const std::string& path, std::ostream& out) {
+    if (pipeline.record_writer == nullptr) return;
+    const uint64_t frames = pipeline.recorded_frames.load();
+    out << "Recording: " << frames << " frames (" << (double)frames / SAMPLE_RATE << " s) saved to " << path;
+    const int files = pipeline.record_writer->files_started();
+    if (files > 1) out << " and " << files - 1 << " numbered continuation file(s)";
+    out << ", " << pipeline.record_lost_frames.load() << " lost to overruns (saved as silence)";
+    if (pipeline.record_failed) out << ", WRITE FAILED (disk full?)";
+    out << "\n";
+}
+
+// Lists the real-time settings that did not take effect (nothing if all did)
+void print_setup_failures(Pipeline& pipeline, std::ostream& out) {
+    std::lock_guard<std::mutex> lock(pipeline.setup_mutex);
+    if (pipeline.setup_failures.empty()) return;
+    out << "Real-time settings not applied:\n";
+    for (const std::string& failure : pipeline.setup_failures) out << "  " << failure << "\n";
+}
 
 // =================================================================================================
-//  Main Function
+//  Pipeline Stages
 // =================================================================================================
-int main() {
-    // --- Pre-computation Step ---
-    std::cout << "Pre-computing steering vectors..." << std::endl;
-    auto all_steering_vectors = precompute_steering_vectors();
-    std::cout << "Done." << std::endl;
-
-    UserData userData;
-    // Buffer for 2 seconds of audio
-    userData.audio_buffer.resize(SAMPLE_RATE * CHANNEL_COUNT * 2); 
-
-    ma_device_config deviceConfig = ma_device_config_init(ma_device_type_capture);
-    deviceConfig.capture.format   = ma_format_f32;
-    deviceConfig.capture.channels = CHANNEL_COUNT;
-    deviceConfig.sampleRate       = SAMPLE_RATE;
-    deviceConfig.dataCallback     = data_callback;
-    deviceConfig.pUserData        = &userData;
-    deviceConfig.periodSizeInFrames = HOP_SIZE;
 
-    ma_device device;
-    if (ma_device_init(NULL, &deviceConfig, &device) != MA_SUCCESS) {
-        std::cerr << "Failed to initialize capture device." << std::endl;
-        return -1;
+// Windows the frame at frame_start straight out of whichever planar ring is in use
+static float stft_from_ring(const UserData* pUserData, uint64_t frame_start, const std::vector<double>& window,
+                            const std::vector<float>& s16_window, float energy_threshold, StftWorkspace& workspace,
+                            std::vector<ComplexVector>& channel_ffts) {
+    if (pUserData->s16) {
+        const int16_t* spans[CHANNEL_COUNT];
+        for (int j = 0; j < CHANNEL_COUNT; ++j) spans[j] = pUserData->ring_s16.channel_span(j, frame_start);
+        return stft_frame(pUserData->doa, spans, s16_window, energy_threshold, workspace, channel_ffts);
     }
-    ma_device_start(&device);
+    const float* spans[CHANNEL_COUNT];
+    for (int j = 0; j < CHANNEL_COUNT; ++j) spans[j] = pUserData->ring.channel_span(j, frame_start);
+    return stft_frame(pUserData->doa, spans, window, energy_threshold, workspace, channel_ffts);
+}
+
+// Waits for each hop, windows it straight out of the planar ring and transforms every channel
+void stft_stage(UserData* pUserData, Pipeline* pipeline, const std::vector<double>* window,
+                const std::vector<float>* s16_window, int cpu) {
+    setup_stage_thread(pipeline, "STFT", cpu, true);
+    const DoaConfig& doa = pUserData->doa;
+    const uint64_t fft_size = doa.fft_size;
+    const uint64_t hop_size = doa.hop_size;
+    const uint64_t overrun_margin = hop_size * OVERRUN_MARGIN_HOPS;
+    StftWorkspace workspace(doa);
+    VoiceActivityDetector vad(pipeline->vad_mode, doa);
+    const bool fixed_threshold = vad.mode() == VadMode::Fixed;
+
+    // Absolute frame index one past the end of the next frame to process
+    uint64_t next_frame_end = fft_size;
+    uint64_t sequence = 0;
+    int next_worker = 0;
+
+    // While a backlog is being worked off, the DOA workers are only woken once every worker has a
+    // full batch queued (or the backlog is gone), so each wakeup beamforms several hops in one pass
+    const int announce_every = pipeline->doa_batch * pipeline->doa_threads;
+    int unannounced = 0;
+    auto announce = [&] {
+        for (int w = 0; w < pipeline->doa_threads; ++w) pipeline->doa_wake[w].notify();
+        unannounced = 0;
+    };
+    auto hop_available = [&] {
+        return pUserData->frames_written() >= next_frame_end && (!pipeline->wait_for_frames || !pipeline->free_frames.empty());
+    };
+
+    while (true) {
+        if (unannounced > 0 && !hop_available()) announce();
+        pUserData->hop_ready.wait([&] {
+            const uint64_t written = pUserData->frames_written();
+            return pipeline->quit_requested || hop_available() ||
+                   (pipeline->source_finished && written < next_frame_end);
+        });
+        if (pipeline->quit_requested) break;
+        if (pipeline->source_finished && pUserData->frames_written() < next_frame_end) {
+            // Replay is over and no full frame is left: tell every worker to finish up
+            for (int w = 0; w < pipeline->doa_threads; ++w) {
+                pipeline->stft_to_doa[w].try_push(END_OF_STREAM);
+                pipeline->doa_wake[w].notify();
+            }
+            break;
+        }
+
+        // If capture has (nearly) lapped us, the frame's samples are being overwritten: resync to the newest hop
+        const uint64_t written = pUserData->frames_written();
+        if (written + overrun_margin > next_frame_end - fft_size + pUserData->ring_capacity()) {
+            pipeline->ring_overruns.fetch_add(1, std::memory_order_relaxed);
+            next_frame_end = std::max<uint64_t>(written / hop_size * hop_size, fft_size);
+        }
+
+        // Complete hops queued behind this one. The newest policy drops them and starts from the newest.
+        uint64_t lag_hops = (written - next_frame_end) / hop_size;
+        if (pipeline->schedule == SchedulePolicy::Newest && lag_hops > 0) {
+            pipeline->skipped_hops.fetch_add(lag_hops, std::memory_order_relaxed);
+            // The detector still hears every skipped hop, so its floor and hangover keep up
+            const uint64_t first_skipped = next_frame_end / hop_size;
+            const uint64_t fed = std::min<uint64_t>(lag_hops, HOP_TIMESTAMP_SLOTS);
+            for (uint64_t hop = first_skipped + lag_hops - fed; hop < first_skipped + lag_hops; ++hop) {
+                vad.update_energy(pUserData->hop_energy[hop % HOP_TIMESTAMP_SLOTS].load(std::memory_order_relaxed));
+            }
+            next_frame_end += lag_hops * hop_size;
+        }
+        if (lag_hops > pipeline->max_lag_hops.load(std::memory_order_relaxed)) {
+            pipeline->max_lag_hops.store((uint32_t)lag_hops, std::memory_order_relaxed);
+        }
+        if (pipeline->schedule == SchedulePolicy::Newest) lag_hops = 0;
+
+        const uint64_t frame_start = next_frame_end - fft_size;
+        const uint64_t hop_index = next_frame_end / hop_size;
+        next_frame_end += hop_size;
+        if (pipeline->lossless) {
+            // The ring frames before the next frame's start can now be overwritten by the source
+            pipeline->stft_position = next_frame_end - fft_size;
+            pipeline->source_wake.notify();
+        }
 
-    size_t processing_head = 0;
-    std::vector<double> process_buffer(FFT_SIZE * CHANNEL_COUNT);
-    // Create a Hamming window for better FFT results
-    std::vector<double> window(FFT_SIZE);
-    for(int i = 0; i < FFT_SIZE; i++) {
-        window[i] = 0.54f - 0.46f * cosf(2.0f * M_PI * i / (FFT_SIZE - 1));
+        // --- VAD stage 1: judge the newest hop from its raw energy before any framing work ---
+        // (also for hops skipped below, so the noise floor and hangover track a backlog)
+        const float hop_energy = pUserData->hop_energy[hop_index % HOP_TIMESTAMP_SLOTS].load(std::memory_order_relaxed);
+        const bool maybe_active = vad.update_energy(hop_energy);
+
+        // The deadline policy skips hops that are already stale, so the backlog drains at no cost
+        const int64_t captured_ns = pUserData->hop_capture_ns[hop_index % HOP_TIMESTAMP_SLOTS].load(std::memory_order_relaxed);
+        if (pipeline->schedule == SchedulePolicy::Deadline &&
+            Clock::now() - Clock::time_point(std::chrono::nanoseconds(captured_ns)) > pipeline->deadline) {
+            pipeline->skipped_hops.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        uint32_t index;
+        if (!pipeline->free_frames.try_pop(index)) {
+            // Every frame is still in flight downstream; skip this hop rather than stall capture
+            pipeline->dropped_hops.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        Frame& frame = pipeline->frames[index];
+        const uint64_t allocations_before = thread_heap_allocations();
+        frame.sequence = sequence++;
+        frame.frame_start = frame_start;
+        frame.captured_at = Clock::time_point(std::chrono::nanoseconds(captured_ns));
+        frame.dequeued_at = Clock::now();
+        frame.lag_hops = (uint32_t)lag_hops;
+
+        frame.noise_floor = fixed_threshold ? 0.0f : std::sqrt(vad.noise_floor());
+        frame.active = false;
+        if (fixed_threshold) {
+            // --- Window, energy-gate and transform each channel straight out of the planar ring ---
+            frame.rms_energy = stft_from_ring(pUserData, frame_start, *window, *s16_window, ENERGY_THRESHOLD,
+                                              workspace, frame.channel_ffts);
+            frame.active = frame.rms_energy >= ENERGY_THRESHOLD;
+        } else {
+            // Silent hops skip the windowing, FFTs and beamformer entirely
+            frame.rms_energy = std::sqrt(hop_energy);
+            if (maybe_active) {
+                stft_from_ring(pUserData, frame_start, *window, *s16_window, 0.0f, workspace, frame.channel_ffts);
+                // --- VAD stage 2 (flux mode): confirm on the centre mic spectrum ---
+                frame.active = vad.confirm_spectrum(frame.channel_ffts[0]);
+            }
+        }
+        frame.fft_done_at = Clock::now();
+        frame.allocations = thread_heap_allocations() - allocations_before;
+
+        pipeline->stft_to_doa[next_worker].try_push(index); // Never full: queues hold the whole pool
+        next_worker = (next_worker + 1) % pipeline->doa_threads;
+        if (++unannounced >= announce_every) announce();
     }
+}
 
+// Runs the beamformer on every frame dealt to this worker. Hops that queue up while it is busy are
+// taken together, up to doa_batch at a time, and share one pass over the steering table.
+void doa_stage(Pipeline* pipeline, int worker, const DoaConfig* doa, const std::vector<SteeringVector>* all_steering_vectors, int cpu) {
+    setup_stage_thread(pipeline, "DOA", cpu, true);
+    FrameQueue& input = pipeline->stft_to_doa[worker];
+    uint32_t batch[MAX_DOA_BATCH];
+    std::vector<ComplexVector>* active_ffts[MAX_DOA_BATCH];
+    std::pair<int, double> results[MAX_DOA_BATCH];
+    float* power_maps[MAX_DOA_BATCH];
+    float* const* maps = pipeline->shm != nullptr ? power_maps : nullptr; // Only --shm needs the full maps
 
     while (true) {
-        if (std::cin.rdbuf()->in_avail() > 0) break;
-
-        size_t captured_head;
-        {
-            std::lock_guard<std::mutex> lock(userData.buffer_mutex);
-            captured_head = userData.head;
-        }
-        
-        // Wait until we have a new hop of audio data
-        if ((captured_head - processing_head + userData.audio_buffer.size()) % userData.audio_buffer.size() >= HOP_SIZE * CHANNEL_COUNT) {
-            
-            // --- Copy a full frame (FFT_SIZE) of data from the circular buffer ---
-            {
-                std::lock_guard<std::mutex> lock(userData.buffer_mutex);
-                size_t start_pos = (processing_head - (FFT_SIZE / 2 * CHANNEL_COUNT) + userData.audio_buffer.size()) % userData.audio_buffer.size();
-                for (int i = 0; i < FFT_SIZE * CHANNEL_COUNT; ++i) {
-                   process_buffer[i] = userData.audio_buffer[(start_pos + i) % userData.audio_buffer.size()];
+        pipeline->doa_wake[worker].wait([&] { return pipeline->quit_requested || !input.empty(); });
+        if (pipeline->quit_requested) break;
+
+        bool end_of_stream = false;
+        while (!end_of_stream) {
+            int count = 0;
+            uint32_t index;
+            while (count < pipeline->doa_batch && input.try_pop(index)) {
+                if (index == END_OF_STREAM) {
+                    end_of_stream = true;
+                    break;
                 }
+                batch[count++] = index;
             }
-            processing_head = (processing_head + HOP_SIZE * CHANNEL_COUNT) % userData.audio_buffer.size();
-            
-            // --- De-interleave and window the audio data ---
-            std::vector<std::vector<float>> channels(CHANNEL_COUNT, std::vector<float>(FFT_SIZE));
-            for(int i = 0; i < FFT_SIZE; ++i) {
-                for(int j = 0; j < CHANNEL_COUNT; ++j) {
-                    channels[j][i] = process_buffer[i * CHANNEL_COUNT + j] * window[i];
+            if (count == 0) break;
+
+            const uint64_t allocations_before = thread_heap_allocations();
+            const Clock::time_point started_at = Clock::now();
+            int active_count = 0;
+            for (int b = 0; b < count; ++b) {
+                Frame& frame = pipeline->frames[batch[b]];
+                if (frame.active) {
+                    power_maps[active_count] = frame.power_map.data();
+                    active_ffts[active_count++] = &frame.channel_ffts;
                 }
             }
 
-            // --- Check energy threshold ---
-            float rms_energy = 0.0f;
-            for (float sample : channels[0]) rms_energy += sample * sample; // Use central mic for energy check
-            rms_energy = std::sqrt(rms_energy / channels[0].size());
-            
-            int final_angle = -1;
-            float beam_energy = 0.0f;
-
-            if (rms_energy >= ENERGY_THRESHOLD) {
-                // --- Perform FFT on all channels ---
-                std::vector<ComplexVector> channel_ffts(CHANNEL_COUNT);
-                for (int i = 0; i < CHANNEL_COUNT; ++i) {
-                    // 1. Copy the real-valued channel data into a complex vector
-                    channel_ffts[i].assign(channels[i].begin(), channels[i].end());
-
-                    // 2. Perform the in-place FFT on the complex vector
-                    Fft::transform(channel_ffts[i]);
+            // --- Run the localization algorithm ---
+            if (active_count == 1) {
+                results[0] = calculate_doa_fft(*doa, *active_ffts[0], *all_steering_vectors, maps ? maps[0] : nullptr);
+            } else if (active_count > 1) {
+                calculate_doa_fft_batch(*doa, active_ffts, active_count, *all_steering_vectors, results, maps);
+            }
+            const Clock::time_point done_at = Clock::now();
+            const uint64_t allocations = thread_heap_allocations() - allocations_before;
+
+            // Every hop of the batch is charged an equal share of its compute time
+            const Clock::duration share = (done_at - started_at) / count;
+            for (int b = 0, next_active = 0; b < count; ++b) {
+                Frame& frame = pipeline->frames[batch[b]];
+                frame.final_angle = -1;
+                frame.beam_energy = 0.0f;
+                if (frame.active) {
+                    frame.final_angle = results[next_active].first;
+                    frame.beam_energy = results[next_active].second;
+                    ++next_active;
                 }
+                frame.doa_started_at = done_at - share;
+                frame.doa_done_at = done_at;
+                if (b == 0) frame.allocations += allocations;
+                pipeline->doa_to_publish[worker].try_push(batch[b]);
+            }
+            pipeline->publish_wake.notify();
+        }
+        if (end_of_stream) {
+            pipeline->doa_to_publish[worker].try_push(END_OF_STREAM);
+            pipeline->publish_wake.notify();
+            return;
+        }
+    }
+}
+
+// When a frame was captured, on the system clock, for results read by other programs
+int64_t capture_unix_ns(const Frame& frame, Clock::time_point published_at) {
+    const auto captured_at = std::chrono::system_clock::now() - (published_at - frame.captured_at);
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(captured_at.time_since_epoch()).count();
+}
+
+// Copies a published frame into the shared-memory record layout
+void fill_shm_record(const Frame& frame, const DoaConfig& doa, Clock::time_point published_at, DoaShmRecord& record) {
+    record.hop = frame.sequence;
+    record.capture_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(frame.captured_at.time_since_epoch()).count();
+    record.capture_unix_ns = capture_unix_ns(frame, published_at);
+    record.audio_time_s = (double)frame.frame_start / doa.sample_rate;
+    record.rms_energy = frame.rms_energy;
+    record.noise_floor = frame.noise_floor;
+    record.active = frame.active ? 1 : 0;
+    record.reserved = 0;
+    if (frame.active) {
+        std::copy(frame.power_map.begin(), frame.power_map.end(), record.power_map);
+        find_power_map_peaks(record);
+    } else {
+        std::fill(record.power_map, record.power_map + DOA_SHM_ANGLES, 0.0f);
+        record.peak_count = 0;
+    }
+    // Unused peak entries are cleared so readers see a deterministic record
+    for (int i = record.peak_count; i < DOA_SHM_MAX_PEAKS; ++i) {
+        record.peak_angles[i] = -1;
+        record.peak_powers[i] = 0.0f;
+    }
+}
+
+// Copies a published frame into the result log layout
+ResultLogRecord make_log_record(const Frame& frame, const DoaConfig& doa, Clock::time_point published_at, double latency_ms) {
+    ResultLogRecord record = {};
+    record.hop = frame.sequence;
+    record.capture_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(frame.captured_at.time_since_epoch()).count();
+    record.capture_unix_ns = capture_unix_ns(frame, published_at);
+    record.audio_time_s = (double)frame.frame_start / doa.sample_rate;
+    record.rms_energy = frame.rms_energy;
+    record.noise_floor = frame.noise_floor;
+    record.beam_power = frame.beam_energy;
+    record.latency_ms = (float)latency_ms;
+    record.angle = (int16_t)frame.final_angle;
+    record.active = frame.active ? 1 : 0;
+    return record;
+}
+
+// Collects results in capture order, publishes them for the dashboard and recycles the frames
+void publish_stage(UserData* pUserData, Pipeline* pipeline, int cpu) {
+    setup_stage_thread(pipeline, "publish", cpu, true);
+    int next_worker = 0;
+    DoaShmRecord shm_record = {};
+
+    while (true) {
+        FrameQueue& input = pipeline->doa_to_publish[next_worker];
+        pipeline->publish_wake.wait([&] { return pipeline->quit_requested || !input.empty(); });
+        if (pipeline->quit_requested) break;
+
+        uint32_t index = 0;
+        input.try_pop(index);
+        if (index == END_OF_STREAM) break; // Every earlier frame has been published
+        const Frame& frame = pipeline->frames[index];
+        const Clock::time_point published_at = Clock::now();
+        auto record = [&](LatencyStage stage, Clock::time_point from, Clock::time_point to) {
+            pipeline->stage_latency[stage].record(std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count());
+        };
+        record(STAGE_CAPTURE_TO_DEQUEUE, frame.captured_at, frame.dequeued_at);
+        record(STAGE_DEQUEUE_TO_FFT, frame.dequeued_at, frame.fft_done_at);
+        record(STAGE_FFT_TO_DOA, frame.fft_done_at, frame.doa_done_at);
+        record(STAGE_DOA_TO_PUBLISH, frame.doa_done_at, published_at);
+        record(STAGE_END_TO_END, frame.captured_at, published_at);
+        double latency_ms = std::chrono::duration<double, std::milli>(published_at - frame.captured_at).count();
+
+        const int64_t work_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            (frame.fft_done_at - frame.dequeued_at) + (frame.doa_done_at - frame.doa_started_at)).count();
+        if (frame.active) {
+            pipeline->active_hops.fetch_add(1, std::memory_order_relaxed);
+            pipeline->active_work_ns.fetch_add(work_ns, std::memory_order_relaxed);
+        } else {
+            pipeline->silent_hops.fetch_add(1, std::memory_order_relaxed);
+            pipeline->silent_work_ns.fetch_add(work_ns, std::memory_order_relaxed);
+        }
+        const uint64_t active_hops = pipeline->active_hops.load(std::memory_order_relaxed);
+        const uint64_t silent_hops = pipeline->silent_hops.load(std::memory_order_relaxed);
+
+        DashboardSnapshot snapshot;
+        snapshot.sequence = frame.sequence;
+        snapshot.rms_energy = frame.rms_energy;
+        snapshot.noise_floor = frame.noise_floor;
+        snapshot.active = frame.active;
+        snapshot.final_angle = frame.final_angle;
+        snapshot.beam_energy = frame.beam_energy;
+        snapshot.latency_ms = latency_ms;
+        snapshot.dropped_hops = pipeline->dropped_hops.load(std::memory_order_relaxed);
+        snapshot.ring_overruns = pipeline->ring_overruns.load(std::memory_order_relaxed);
+        snapshot.allocations = frame.allocations;
+        snapshot.silent_fraction = (double)silent_hops / (active_hops + silent_hops);
+        snapshot.saved_watts = vad_saved_watts(*pipeline);
+        snapshot.lag_hops = frame.lag_hops;
+        snapshot.max_lag_hops = pipeline->max_lag_hops.load(std::memory_order_relaxed);
+        snapshot.skipped_hops = pipeline->skipped_hops.load(std::memory_order_relaxed);
+        pipeline->latest.store(snapshot);
+        if (pipeline->shm != nullptr) {
+            fill_shm_record(frame, pUserData->doa, published_at, shm_record);
+            pipeline->shm->publish(shm_record);
+        }
+        if (pipeline->result_log != nullptr) {
+            pipeline->result_log->push(make_log_record(frame, pUserData->doa, published_at, latency_ms));
+        }
+
+        if (pipeline->print_results) {
+            // hop, start time (s), RMS energy, angle (-1 = none), beamformer power
+            printf("%llu,%.4f,%.5f,%d,%.4f\n", (unsigned long long)frame.sequence,
+                   (double)frame.frame_start / pUserData->doa.sample_rate, frame.rms_energy, frame.final_angle, frame.beam_energy);
+        }
+        pipeline->hops_published.fetch_add(1, std::memory_order_relaxed);
+
+        pipeline->free_frames.try_push(index);
+        if (pipeline->wait_for_frames) pUserData->hop_ready.notify(); // A free frame unblocks the STFT stage
+        next_worker = (next_worker + 1) % pipeline->doa_threads;
+    }
+}
+
+// Copies ring frames [position, position + frames) of every channel to out + c * stride
+template <typename Sample>
+void copy_ring_frames(const BasicPlanarRing<Sample>& ring, uint64_t position, size_t frames, Sample* out, size_t stride) {
+    for (int c = 0; c < CHANNEL_COUNT; ++c) std::memcpy(out + c * stride, ring.channel_span(c, position), frames * sizeof(Sample));
+}
+
+// Streams the capture ring to the --record file through a capture writer (CSV, .u8c, .u8z or WAV). It reads
+// behind the capture at its own pace and never signals or waits for the callback; the ring
+// (RECORD_RING_SECONDS) is the only buffer. Frames the capture overwrites before they are saved are
+// written as silence, so frame r of the file is always ring frame r: the frame_start / time_s the
+// results are stamped with.
+void record_stage(UserData* pUserData, Pipeline* pipeline) {
+    const uint64_t capacity = pUserData->ring_capacity();
+    const uint64_t chunk_frames = pUserData->doa.fft_size; // Ring spans are contiguous up to this length
+    const uint64_t overrun_margin = (uint64_t)pUserData->doa.hop_size * OVERRUN_MARGIN_HOPS;
 
-                // --- Run the localization algorithm ---
-                auto result = calculate_doa_fft(channel_ffts, all_steering_vectors);
-                final_angle = result.first;
-                beam_energy = result.second;
+    // Each chunk is copied out of the ring first, so one the capture overwrites mid-copy can still
+    // be replaced by silence before it reaches the file
+    std::vector<float> copy_f32(pUserData->s16 ? 0 : chunk_frames * CHANNEL_COUNT);
+    std::vector<int16_t> copy_s16(pUserData->s16 ? chunk_frames * CHANNEL_COUNT : 0);
+    const float* planar_f32[CHANNEL_COUNT];
+    const int16_t* planar_s16[CHANNEL_COUNT];
+    for (int c = 0; c < CHANNEL_COUNT; ++c) {
+        planar_f32[c] = copy_f32.data() + c * chunk_frames;
+        planar_s16[c] = copy_s16.data() + c * chunk_frames;
+    }
+    // System clock time ring frame `position` was captured, to within one device buffer: the hop
+    // holding it arrived at hop_capture_ns, and the frame is that many samples older. Hops whose
+    // stamp slot may already be reused are timed back from a newer hop at the sample rate. A fast
+    // replay has no capture timeline, so its recording is left untimed.
+    const uint64_t hop_size = pUserData->doa.hop_size;
+    const double ns_per_frame = 1e9 / pUserData->doa.sample_rate;
+    const uint64_t stamp_reach = HOP_TIMESTAMP_SLOTS - 8; // Callbacks stamp a few hops ahead of frames_written
+    auto capture_time_ns = [&](uint64_t position) -> int64_t {
+        const uint64_t newest_hop = pUserData->frames_written() / hop_size;
+        uint64_t hop = position / hop_size + 1;
+        if (newest_hop > hop + stamp_reach) hop = newest_hop - stamp_reach;
+        const int64_t captured_ns = pUserData->hop_capture_ns[hop % HOP_TIMESTAMP_SLOTS].load(std::memory_order_relaxed);
+        if (captured_ns == 0) return 0;
+        const int64_t steady_now = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+        const int64_t system_now =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        return captured_ns + (system_now - steady_now) - (int64_t)((hop * hop_size - position) * ns_per_frame);
+    };
+
+    std::string error;
+    auto write_chunk = [&](uint64_t position, size_t frames, bool silent) {
+        if (silent) {
+            std::fill(copy_f32.begin(), copy_f32.end(), 0.0f);
+            std::fill(copy_s16.begin(), copy_s16.end(), (int16_t)0);
+        }
+        CaptureChunk chunk;
+        if (pUserData->s16) {
+            chunk.s16 = planar_s16;
+        } else {
+            chunk.f32 = planar_f32;
+        }
+        chunk.frames = frames;
+        chunk.first_frame = position;
+        chunk.time_unix_ns = pipeline->lossless ? 0 : capture_time_ns(position);
+        if (!pipeline->record_failed && !pipeline->record_writer->write(chunk, error)) {
+            pipeline->record_failed = true; // Keep draining so the timeline accounting stays right
+        }
+    };
+    auto write_silence = [&](uint64_t position, uint64_t frames) {
+        for (uint64_t done = 0; done < frames; done += chunk_frames) {
+            write_chunk(position + done, (size_t)std::min(chunk_frames, frames - done), true);
+        }
+    };
+    // True once the capture may have started overwriting the frame at `position`
+    auto lapped = [&](uint64_t position) { return pUserData->frames_written() + overrun_margin > position + capacity; };
+
+    uint64_t position = 0;
+    while (true) {
+        // Checked before draining, so everything captured up to the stop is saved
+        const bool finishing = pipeline->quit_requested || pipeline->source_finished;
+        const uint64_t written = pUserData->frames_written();
+        while (position < written) {
+            if (lapped(position)) {
+                const uint64_t resume = written + overrun_margin - capacity;
+                write_silence(position, resume - position);
+                pipeline->record_lost_frames.fetch_add(resume - position, std::memory_order_relaxed);
+                position = resume;
+                continue;
+            }
+            const size_t frames = (size_t)std::min(chunk_frames, written - position);
+            if (pUserData->s16) {
+                copy_ring_frames(pUserData->ring_s16, position, frames, copy_s16.data(), chunk_frames);
+            } else {
+                copy_ring_frames(pUserData->ring, position, frames, copy_f32.data(), chunk_frames);
+            }
+            // Overwritten while being copied: the chunk may mix old and new audio
+            const bool torn = lapped(position);
+            if (torn) pipeline->record_lost_frames.fetch_add(frames, std::memory_order_relaxed);
+            write_chunk(position, frames, torn);
+            position += frames;
+            pipeline->recorded_frames.store(position, std::memory_order_relaxed);
+            if (pipeline->lossless) {
+                pipeline->record_position = position;
+                pipeline->source_wake.notify();
             }
-            
-            print_debug_dashboard(rms_energy, final_angle, beam_energy);
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        if (finishing) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(RECORD_POLL_MS));
     }
+    if (!pipeline->record_writer->close(error)) pipeline->record_failed = true;
+}
 
-    std::cout << "\nStopping device..." << std::endl;
+// Redraws the dashboard at a fixed rate from the latest published snapshot
+void dashboard_stage(Pipeline* pipeline, int refresh_hz, int cpu) {
+    setup_stage_thread(pipeline, "dashboard", cpu, false);
+    const auto period = std::chrono::microseconds(1000000 / refresh_hz);
+    DashboardGrid shown;
+    DashboardGrid next;
+    std::memset(shown, ' ', sizeof(shown));
+    init_dashboard_terminal();
+
+    uint64_t drawn_version = ~0ull;
+    while (!pipeline->quit_requested) {
+        uint64_t version = pipeline->latest.version();
+        if (version != drawn_version) {
+            DashboardSnapshot snapshot = {};
+            bool have_result = pipeline->latest.load(snapshot);
+            format_dashboard(snapshot, have_result, next);
+            redraw_changed_cells(next, shown);
+            drawn_version = version;
+        }
+        if (pipeline->report_requested.exchange(false)) {
+            std::cout << "\033[" << DASHBOARD_ROWS + 2 << ";1H\033[J";
+            print_latency_report(*pipeline, std::cout);
+            std::cout << std::flush;
+        }
+        pipeline->dashboard_wake.wait_for(period, [&] {
+            return pipeline->quit_requested.load() || pipeline->report_requested.load();
+        });
+    }
+}
+
+// =================================================================================================
+//  Command Line
+// =================================================================================================
+void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --doa-threads N     Number of beamformer worker threads (1-" << MAX_DOA_THREADS << ", default 1)\n"
+              << "  --stft-cpu N        Pin the windowing/FFT stage to CPU N\n"
+              << "  --doa-cpus A,B,...  Pin DOA worker i to the i-th listed CPU\n"
+              << "  --doa-batch N       Most queued hops beamformed per steering-table pass (1-"
+              << MAX_DOA_BATCH << ", default " << MAX_DOA_BATCH << ")\n"
+              << "  --publish-cpu N     Pin the publish stage to CPU N\n"
+              << "  --dashboard-hz N    Dashboard refresh rate (default " << DEFAULT_DASHBOARD_HZ << ")\n"
+              << "  --dashboard-cpu N   Pin the dashboard thread to CPU N\n"
+              << "  --rt-priority N     Run the processing stages under SCHED_FIFO at priority N (1-99)\n"
+              << "                      and ask for a real-time capture thread\n"
+              << "  --lock-memory       Lock the process in RAM and prefault the ring and steering tables\n"
+              << "  --record FILE       Also stream the raw 8-channel capture to FILE (.wav, .u8c, .u8z, otherwise CSV)\n"
+              << "  --log FILE          Headless: log every result to FILE (- for stdout) instead of\n"
+              << "                      showing the dashboard\n"
+              << "  --log-format FMT    jsonl (JSON object per line, default) or binary\n"
+              << "  --shm NAME          Publish every result into the shared-memory ring NAME for other\n"
+              << "                      processes (e.g. " << DOA_SHM_DEFAULT_NAME << "; read it with tdoa_listen)\n"
+              << "  --decimate N        Decimate 48 kHz to 16 kHz (3) or 12 kHz (4) before framing\n"
+              << "  --s16               Capture 16-bit samples (converted to float while windowing)\n"
+              << "  --vad MODE          Hop gating: fixed (energy threshold), adaptive (default)\n"
+              << "                      or flux (adaptive plus spectral flux)\n"
+              << "  --core-watts W      Power of one busy core, for the saving estimate (default 1.0)\n"
+              << "  --schedule POLICY   Backlog handling: batch (catch up in order, default), newest\n"
+              << "                      (skip to the newest hop) or deadline (skip stale hops)\n"
+              << "  --deadline-ms N     Age past which --schedule deadline skips a hop (default "
+              << DEFAULT_DEADLINE_MS << ")\n"
+              << "  --replay FILE       Run on a recorded capture (CSV, .u8c or .u8z) instead of the device\n"
+              << "  --fast              Replay as fast as possible (default: wall-clock pace)\n"
+              << "  --quiet             Replay: print only the summary, not every hop\n";
+}
+
+bool parse_options(int argc, char** argv, PipelineOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        try {
+            if (arg == "--doa-threads" && has_value) {
+                options.doa_threads = std::stoi(argv[++i]);
+                if (options.doa_threads < 1 || options.doa_threads > MAX_DOA_THREADS) return false;
+            } else if (arg == "--stft-cpu" && has_value) {
+                options.stft_cpu = std::stoi(argv[++i]);
+            } else if (arg == "--doa-batch" && has_value) {
+                options.doa_batch = std::stoi(argv[++i]);
+                if (options.doa_batch < 1 || options.doa_batch > MAX_DOA_BATCH) return false;
+            } else if (arg == "--doa-cpus" && has_value) {
+                if (!parse_cpu_list(argv[++i], options.doa_cpus)) return false;
+            } else if (arg == "--publish-cpu" && has_value) {
+                options.publish_cpu = std::stoi(argv[++i]);
+            } else if (arg == "--dashboard-hz" && has_value) {
+                options.dashboard_hz = std::stoi(argv[++i]);
+                if (options.dashboard_hz < 1 || options.dashboard_hz > 1000) return false;
+            } else if (arg == "--dashboard-cpu" && has_value) {
+                options.dashboard_cpu = std::stoi(argv[++i]);
+            } else if (arg == "--rt-priority" && has_value) {
+                options.rt_priority = std::stoi(argv[++i]);
+                if (options.rt_priority < 1 || options.rt_priority > 99) return false;
+            } else if (arg == "--lock-memory") {
+                options.lock_memory = true;
+            } else if (arg == "--record" && has_value) {
+                options.record_path = argv[++i];
+                if (options.record_path.empty()) return false;
+            } else if (arg == "--log" && has_value) {
+                options.log_path = argv[++i];
+                if (options.log_path.empty()) return false;
+            } else if (arg == "--log-format" && has_value) {
+                if (!parse_result_log_format(argv[++i], options.log_format)) return false;
+            } else if (arg == "--shm" && has_value) {
+                options.shm_name = argv[++i];
+                if (options.shm_name.empty()) return false;
+            } else if (arg == "--decimate" && has_value) {
+                options.decimation = std::stoi(argv[++i]);
+            } else if (arg == "--s16") {
+                options.s16 = true;
+            } else if (arg == "--vad" && has_value) {
+                if (!parse_vad_mode(argv[++i], options.vad_mode)) return false;
+            } else if (arg == "--core-watts" && has_value) {
+                options.core_watts = std::stod(argv[++i]);
+            } else if (arg == "--schedule" && has_value) {
+                if (!parse_schedule_policy(argv[++i], options.schedule)) return false;
+            } else if (arg == "--deadline-ms" && has_value) {
+                options.deadline_ms = std::stoi(argv[++i]);
+                if (options.deadline_ms < 1) return false;
+            } else if (arg == "--replay" && has_value) {
+                options.replay_path = argv[++i];
+            } else if (arg == "--fast") {
+                options.replay_fast = true;
+            } else if (arg == "--quiet") {
+                options.quiet = true;
+            } else {
+                return false;
+            }
+        } catch (...) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// =================================================================================================
+//  Main Function
+// =================================================================================================
+int main(int argc, char** argv) {
+    PipelineOptions options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    // Replay writes per-hop results to stdout, so progress messages go to stderr there (as they
+    // do when the result log is stdout). A result log replaces the dashboard.
+    const bool replaying = !options.replay_path.empty();
+    const bool headless = !options.log_path.empty();
+    const bool log_to_stdout = options.log_path == "-";
+    std::ostream& log = replaying || log_to_stdout ? std::cerr : std::cout;
+
+    DoaConfig doa;
+    std::string config_error;
+    if (!make_doa_config(options.decimation, doa, config_error)) {
+        std::cerr << "Error: " << config_error << std::endl;
+        return -1;
+    }
+    if (doa.decimation > 1) {
+        log << "Decimating " << SAMPLE_RATE << " Hz to " << doa.sample_rate << " Hz, "
+            << doa.fft_size << "-point FFTs." << std::endl;
+    }
+
+    // --- Pre-computation Step ---
+    log << "Pre-computing steering vectors..." << std::endl;
+    auto all_steering_vectors = precompute_steering_vectors(doa);
+    log << "Done." << std::endl;
+
+    const std::vector<double> window = make_analysis_window(doa);
+    const std::vector<float> s16_window = make_s16_analysis_window(doa);
+
+    const bool recording = !options.record_path.empty();
+    if (recording && doa.decimation > 1) {
+        // The ring holds decimated audio, which the capture CSV format (48 kHz) cannot describe
+        std::cerr << "Error: --record needs the full-rate ring and cannot be combined with --decimate" << std::endl;
+        return -1;
+    }
+
+    UserData userData(doa, options.s16, recording ? RECORD_RING_SECONDS : RING_SECONDS);
+    Pipeline pipeline;
+    pipeline.frames.assign(FRAME_POOL_SIZE, Frame(doa.fft_size));
+    pipeline.doa_threads = options.doa_threads;
+    pipeline.doa_batch = options.doa_batch;
+    pipeline.vad_mode = options.vad_mode;
+    pipeline.core_watts = options.core_watts;
+    pipeline.hop_seconds = (double)doa.hop_size / doa.sample_rate;
+    pipeline.schedule = options.schedule;
+    pipeline.deadline = std::chrono::milliseconds(options.deadline_ms);
+    pipeline.rt_priority = options.rt_priority;
+    pipeline.headless = headless;
+    for (uint32_t i = 0; i < FRAME_POOL_SIZE; ++i) pipeline.free_frames.try_push(i);
+
+    std::vector<float> replay_audio;
+    if (replaying) {
+        std::string error;
+        log << "Loading " << options.replay_path << "..." << std::endl;
+        bool loaded = false;
+        if (is_capture_file(options.replay_path)) {
+            loaded = load_capture_file(options.replay_path, CHANNEL_COUNT, SAMPLE_RATE, replay_audio, error);
+        } else if (is_compressed_capture(options.replay_path)) {
+            loaded = load_capture_compressed(options.replay_path, CHANNEL_COUNT, SAMPLE_RATE, replay_audio, error);
+        } else {
+            loaded = load_capture_csv(options.replay_path, CHANNEL_COUNT, replay_audio, error);
+        }
+        if (!loaded) {
+            std::cerr << "Failed to load replay: " << error << std::endl;
+            return -1;
+        }
+        pipeline.lossless = options.replay_fast;
+        pipeline.print_results = !options.quiet && !log_to_stdout;
+        if (pipeline.print_results) printf("hop,time_s,rms,angle,power\n");
+    }
+    // The batch schedule works a backlog off through the batched beamformer instead of dropping
+    // hops when every frame is in flight; the ring overrun check still bounds how far it lags
+    pipeline.wait_for_frames = pipeline.lossless || options.schedule == SchedulePolicy::Batch;
+
+    // Replay in the capture format, as the device would deliver it
+    std::vector<int16_t> replay_audio_s16;
+    if (replaying && options.s16) {
+        replay_audio_s16.resize(replay_audio.size());
+        convert_f32_to_s16(replay_audio.data(), replay_audio_s16.data(), replay_audio.size());
+    }
+
+    DoaShmWriter shm;
+    if (!options.shm_name.empty()) {
+        std::string error;
+        if (!shm.open(options.shm_name, doa, error)) {
+            std::cerr << "Error: " << error << std::endl;
+            return -1;
+        }
+        pipeline.shm = &shm;
+        log << "Publishing results to shared memory " << options.shm_name << "." << std::endl;
+    }
+    RotatingCaptureWriter record_writer; // No rotation, except where the format needs it (WAV)
+    if (recording) {
+        const CaptureFileFormat format = capture_file_format_for_path(options.record_path);
+        CaptureStreamInfo stream_info;
+        stream_info.sample_rate = SAMPLE_RATE;
+        stream_info.channels = CHANNEL_COUNT;
+        stream_info.s16 = options.s16;
+        stream_info.speed_of_sound = SPEED_OF_SOUND;
+        stream_info.mic_positions = MIC_POSITIONS;
+        std::string error;
+        if (!record_writer.open(options.record_path, format, stream_info, CaptureRotation(), error)) {
+            std::cerr << "Error: " << error << std::endl;
+            return -1;
+        }
+        pipeline.record_writer = &record_writer;
+        log << "Recording the capture to " << options.record_path << " (" << capture_file_format_name(format) << ")." << std::endl;
+    }
+    ResultLogWriter result_log;
+    if (headless) {
+        std::string error;
+        if (!result_log.open(options.log_path, options.log_format, doa, error)) {
+            std::cerr << "Error: " << error << std::endl;
+            return -1;
+        }
+        pipeline.result_log = &result_log;
+        log << "Logging results (" << result_log_format_name(options.log_format) << ") to "
+            << (log_to_stdout ? "stdout" : options.log_path) << "." << std::endl;
+    }
+
+    // --- Memory locking: everything the processing threads touch is allocated by now ---
+    if (options.lock_memory) {
+        const size_t bytes = prefault_working_set(userData, pipeline, all_steering_vectors);
+        log << "Prefaulted " << bytes / (1024 * 1024) << " MB of ring, frames and steering tables." << std::endl;
+        std::string error;
+        if (!lock_process_memory(error)) report_setup_failure(&pipeline, "could not lock memory: " + error);
+    }
+
+    ma_context context;
+    ma_device device;
+    if (!replaying) {
+        // miniaudio quietly falls back to a normal thread if real-time is refused; the capture
+        // callback records what it actually got
+        ma_context_config contextConfig = ma_context_config_init();
+        if (options.rt_priority > 0) contextConfig.threadPriority = ma_thread_priority_realtime;
+        if (ma_context_init(NULL, 0, &contextConfig, &context) != MA_SUCCESS) {
+            std::cerr << "Failed to initialize audio context." << std::endl;
+            return -1;
+        }
+
+        ma_device_config deviceConfig = ma_device_config_init(ma_device_type_capture);
+        deviceConfig.capture.format   = options.s16 ? ma_format_s16 : ma_format_f32;
+        deviceConfig.capture.channels = CHANNEL_COUNT;
+        deviceConfig.sampleRate       = SAMPLE_RATE;
+        deviceConfig.dataCallback     = data_callback;
+        deviceConfig.pUserData        = &userData;
+        deviceConfig.periodSizeInFrames = doa.hop_size * doa.decimation;
+
+        if (ma_device_init(&context, &deviceConfig, &device) != MA_SUCCESS) {
+            std::cerr << "Failed to initialize capture device." << std::endl;
+            ma_context_uninit(&context);
+            return -1;
+        }
+    }
+
+    // --- Start the stages downstream-first, then the audio source ---
+    std::thread dashboard_thread;
+    if (!replaying && !headless) {
+        dashboard_thread = std::thread(dashboard_stage, &pipeline, options.dashboard_hz, options.dashboard_cpu);
+    }
+    std::vector<std::thread> stage_threads;
+    stage_threads.emplace_back(publish_stage, &userData, &pipeline, options.publish_cpu);
+    for (int w = 0; w < options.doa_threads; ++w) {
+        int cpu = w < (int)options.doa_cpus.size() ? options.doa_cpus[w] : -1;
+        stage_threads.emplace_back(doa_stage, &pipeline, w, &doa, &all_steering_vectors, cpu);
+    }
+    stage_threads.emplace_back(stft_stage, &userData, &pipeline, &window, &s16_window, options.stft_cpu);
+    if (recording) stage_threads.emplace_back(record_stage, &userData, &pipeline);
+
+    if (replaying) {
+        // The replay ends on its own, so stdin is left alone (it may be closed in scripted runs)
+        const Clock::time_point start = Clock::now();
+        const void* replay_data = options.s16 ? (const void*)replay_audio_s16.data() : (const void*)replay_audio.data();
+        replay_source(&userData, &pipeline, replay_data, replay_audio.size() / CHANNEL_COUNT, options.replay_fast);
+        for (auto& t : stage_threads) t.join();
+        const double elapsed_s = std::chrono::duration<double>(Clock::now() - start).count();
+        result_log.close();
+
+        const uint64_t hops = pipeline.hops_published.load();
+        const double audio_s = (double)replay_audio.size() / CHANNEL_COUNT / SAMPLE_RATE;
+        fflush(stdout);
+        std::cerr << "\n--- Replay summary ---\n"
+                  << "Hops processed: " << hops << " in " << elapsed_s << " s ("
+                  << hops / elapsed_s << " frames/s, " << audio_s / elapsed_s << "x real time)\n";
+        print_latency_report(pipeline, std::cerr);
+        print_result_log_summary(pipeline, std::cerr);
+        print_record_summary(pipeline, options.record_path, std::cerr);
+        print_setup_failures(pipeline, std::cerr);
+        return 0;
+    }
+
+    ma_device_start(&device);
+    if (headless) log << "Running headless. Press Enter to quit, or type s + Enter for latency stats." << std::endl;
+    std::thread input_thread(input_thread_func, &userData, &pipeline);
+    input_thread.join();
+
+    log << "\nStopping device..." << std::endl;
     ma_device_uninit(&device);
+    ma_context_uninit(&context);
+    for (auto& t : stage_threads) t.join();
+    if (dashboard_thread.joinable()) dashboard_thread.join();
+    result_log.close();
+    if (options.rt_priority > 0 && userData.capture_thread_realtime.load() == 0) {
+        report_setup_failure(&pipeline, "the capture thread did not get real-time priority");
+    }
+
+    log << "\n--- Latency report ---\n";
+    print_latency_report(pipeline, log);
+    print_result_log_summary(pipeline, log);
+    print_record_summary(pipeline, options.record_path, log);
+    print_setup_failures(pipeline, log);
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,180 @@
+#include "thread_util.hpp"
+
+#include <sstream>
+#include <stdexcept>
+
+#if defined(_WIN32)
+    #include <windows.h>
+#elif defined(__linux__)
+    #include <pthread.h>
+    #include <sched.h>
+    #include <sys/mman.h>
+    #include <cerrno>
+    #include <cstring>
+#endif
+
+#if defined(__APPLE__)
+    #include <dispatch/dispatch.h> // Unnamed POSIX semaphores are not implemented on macOS
+#elif !defined(_WIN32)
+    #include <semaphore.h>
+    #include <cerrno>
+    #include <cstring>
+#endif
+
+const size_t PREFAULT_STRIDE = 4096; // Smallest page size we run on
+
+bool pin_current_thread(int cpu, std::string& error) {
+    if (cpu < 0) {
+        error = "invalid CPU index " + std::to_string(cpu);
+        return false;
+    }
+#if defined(_WIN32)
+    if (cpu >= 64 || SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu) == 0) {
+        error = "SetThreadAffinityMask failed for CPU " + std::to_string(cpu);
+        return false;
+    }
+    return true;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (rc != 0) {
+        error = "pthread_setaffinity_np failed for CPU " + std::to_string(cpu) + ": " + std::strerror(rc);
+        return false;
+    }
+    return true;
+#else
+    error = "thread affinity is not supported on this platform";
+    return false;
+#endif
+}
+
+bool parse_cpu_list(const std::string& text, std::vector<int>& cpus) {
+    cpus.clear();
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        try {
+            size_t used = 0;
+            int cpu = std::stoi(item, &used);
+            if (used != item.size() || cpu < 0) return false;
+            cpus.push_back(cpu);
+        } catch (...) {
+            return false;
+        }
+    }
+    return !cpus.empty();
+}
+
+bool set_current_thread_realtime(int priority, std::string& error) {
+#if defined(_WIN32)
+    (void)priority;
+    if (!SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL)) {
+        error = "SetThreadPriority(THREAD_PRIORITY_TIME_CRITICAL) failed";
+        return false;
+    }
+    return true;
+#elif defined(__linux__)
+    const int min_priority = sched_get_priority_min(SCHED_FIFO);
+    const int max_priority = sched_get_priority_max(SCHED_FIFO);
+    if (priority < min_priority || priority > max_priority) {
+        error = "SCHED_FIFO priority must be " + std::to_string(min_priority) + "-" + std::to_string(max_priority);
+        return false;
+    }
+    sched_param param;
+    param.sched_priority = priority;
+    int rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (rc != 0) {
+        error = "SCHED_FIFO priority " + std::to_string(priority) + " refused: " + std::strerror(rc);
+        return false;
+    }
+    return true;
+#else
+    (void)priority;
+    error = "real-time scheduling is not supported on this platform";
+    return false;
+#endif
+}
+
+bool current_thread_is_realtime() {
+#if defined(_WIN32)
+    return GetThreadPriority(GetCurrentThread()) == THREAD_PRIORITY_TIME_CRITICAL;
+#elif defined(__linux__)
+    int policy = 0;
+    sched_param param;
+    if (pthread_getschedparam(pthread_self(), &policy, &param) != 0) return false;
+    return policy == SCHED_FIFO || policy == SCHED_RR;
+#else
+    return false;
+#endif
+}
+
+bool lock_process_memory(std::string& error) {
+#if defined(__linux__)
+    if (mlockall(MCL_CURRENT) != 0) {
+        error = std::string("mlockall failed: ") + std::strerror(errno);
+        return false;
+    }
+    return true;
+#else
+    error = "locking process memory is not supported on this platform";
+    return false;
+#endif
+}
+
+void prefault_pages(void* data, size_t bytes) {
+    // A read alone would map an untouched page to the shared zero page; the write allocates it
+    volatile unsigned char* p = (volatile unsigned char*)data;
+    for (size_t offset = 0; offset < bytes; offset += PREFAULT_STRIDE) p[offset] = p[offset];
+    if (bytes > 0) p[bytes - 1] = p[bytes - 1];
+}
+
+// --- RealtimeWakeSignal: a counting semaphore per platform; posting never waits ---
+#if defined(_WIN32)
+
+RealtimeWakeSignal::RealtimeWakeSignal() : semaphore_(CreateSemaphoreA(nullptr, 0, 0x7FFFFFFF, nullptr)) {
+    if (semaphore_ == nullptr) throw std::runtime_error("CreateSemaphore failed (error " + std::to_string(GetLastError()) + ")");
+}
+
+RealtimeWakeSignal::~RealtimeWakeSignal() { CloseHandle(semaphore_); }
+
+void RealtimeWakeSignal::post() { ReleaseSemaphore(semaphore_, 1, nullptr); }
+
+void RealtimeWakeSignal::wait_for_post() { WaitForSingleObject(semaphore_, INFINITE); }
+
+#elif defined(__APPLE__)
+
+RealtimeWakeSignal::RealtimeWakeSignal() : semaphore_(dispatch_semaphore_create(0)) {
+    if (semaphore_ == nullptr) throw std::runtime_error("dispatch_semaphore_create failed");
+}
+
+RealtimeWakeSignal::~RealtimeWakeSignal() { dispatch_release((dispatch_semaphore_t)semaphore_); }
+
+void RealtimeWakeSignal::post() { dispatch_semaphore_signal((dispatch_semaphore_t)semaphore_); }
+
+void RealtimeWakeSignal::wait_for_post() { dispatch_semaphore_wait((dispatch_semaphore_t)semaphore_, DISPATCH_TIME_FOREVER); }
+
+#else
+
+RealtimeWakeSignal::RealtimeWakeSignal() : semaphore_(new sem_t) {
+    if (sem_init(static_cast<sem_t*>(semaphore_), 0, 0) != 0) {
+        const int code = errno;
+        delete static_cast<sem_t*>(semaphore_);
+        throw std::runtime_error(std::string("sem_init failed: ") + std::strerror(code));
+    }
+}
+
+RealtimeWakeSignal::~RealtimeWakeSignal() {
+    sem_destroy(static_cast<sem_t*>(semaphore_));
+    delete static_cast<sem_t*>(semaphore_);
+}
+
+// sem_post is async-signal-safe: an atomic increment, plus a futex wake if the waiter sleeps
+void RealtimeWakeSignal::post() { sem_post(static_cast<sem_t*>(semaphore_)); }
+
+void RealtimeWakeSignal::wait_for_post() {
+    while (sem_wait(static_cast<sem_t*>(semaphore_)) != 0 && errno == EINTR) {}
+}
+
+#endif
@@ -0,0 +1,74 @@
+// =================================================================================================
+// Thread placement and real-time setup helpers for the capture programs
+// =================================================================================================
+//
+// Every helper reports whether it worked instead of failing silently: real-time scheduling and
+// memory locking usually need privileges (root, CAP_SYS_NICE / CAP_IPC_LOCK, or rtprio and
+// memlock limits in /etc/security/limits.conf), and the caller should tell the user what it
+// could not apply.
+// =================================================================================================
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Pins the calling thread to one CPU core. Returns false and fills `error` if the platform does not
+// support it or the request was refused.
+bool pin_current_thread(int cpu, std::string& error);
+
+// Parses a comma separated CPU list such as "2,3,5". Returns false on malformed input.
+bool parse_cpu_list(const std::string& text, std::vector<int>& cpus);
+
+// Moves the calling thread to SCHED_FIFO at `priority` (1-99; Windows: time-critical priority).
+// Returns false and fills `error` if the policy was refused.
+bool set_current_thread_realtime(int priority, std::string& error);
+
+// True if the calling thread runs under a real-time policy. Makes no allocations, so it is safe
+// to call once from an audio callback to check what the audio library actually got.
+bool current_thread_is_realtime();
+
+// Locks every page the process has mapped in RAM (mlockall(MCL_CURRENT)), so the processing
+// threads never stall on a page fault. Call it once everything they touch is allocated; later
+// allocations are deliberately not locked, since with a small memlock limit that would make them
+// (thread stacks included) fail. Returns false and fills `error` if refused or unsupported.
+bool lock_process_memory(std::string& error);
+
+// Rewrites one byte per page of [data, data + bytes) with its own value, so reserved but untouched
+// pages get backed by RAM before they are needed. Only call it before other threads use the data.
+void prefault_pages(void* data, size_t bytes);
+
+// Wakes one waiting thread without ever blocking the notifier, so a real-time thread (the capture
+// callback) can raise it. notify() is an atomic exchange plus, once per wakeup, a semaphore post;
+// WakeSignal (spsc_queue.hpp) instead takes a mutex, which a preempted waiter may be holding.
+class RealtimeWakeSignal {
+public:
+    RealtimeWakeSignal(); // Throws std::runtime_error if the platform semaphore cannot be created
+    ~RealtimeWakeSignal();
+    RealtimeWakeSignal(const RealtimeWakeSignal&) = delete;
+    RealtimeWakeSignal& operator=(const RealtimeWakeSignal&) = delete;
+
+    // Any thread. Call it after publishing whatever the waiter's predicate reads.
+    void notify() {
+        if (!signaled_.exchange(true, std::memory_order_acq_rel)) post();
+    }
+
+    // A single waiting thread: returns once `ready()` holds. Clearing the flag with an exchange
+    // pairs with the notifier's, so a notify() that found it already set is still seen by ready().
+    template <typename Predicate>
+    void wait(Predicate ready) {
+        while (!ready()) {
+            wait_for_post();
+            signaled_.exchange(false, std::memory_order_acq_rel);
+        }
+    }
+
+private:
+    void post();
+    void wait_for_post();
+
+    std::atomic<bool> signaled_{false}; // A post is pending or in flight
+    void* semaphore_ = nullptr;
+};
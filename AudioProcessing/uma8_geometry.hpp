@@ -0,0 +1,26 @@
+// =================================================================================================
+// UMA-8 array configuration shared by the capture, localization and simulation programs
+// =================================================================================================
+
+#pragma once
+
+#define _USE_MATH_DEFINES //added due to math error
+#include <cmath>
+#include <utility>
+#include <vector>
+
+const int SAMPLE_RATE = 48000;
+const int CHANNEL_COUNT = 8;
+const float SPEED_OF_SOUND = 343.0f; // meters per second
+const float MIC_RADIUS = 0.045f;     // 45mm for UMA-8
+
+const std::vector<std::pair<float, float>> MIC_POSITIONS = {
+    {0.0f, 0.0f}, //Mic 0 (center) - Not used in DOA
+    {MIC_RADIUS * cosf(0.0f * M_PI / 180.0f), MIC_RADIUS * sinf(0.0f * M_PI / 180.0f)},   // Mic 1 (0 deg)
+    {MIC_RADIUS * cosf(60.0f * M_PI / 180.0f), MIC_RADIUS * sinf(60.0f * M_PI / 180.0f)},  // Mic 2 (60 deg)
+    {MIC_RADIUS * cosf(120.0f * M_PI / 180.0f), MIC_RADIUS * sinf(120.0f * M_PI / 180.0f)},// Mic 3 (120 deg)
+    {MIC_RADIUS * cosf(180.0f * M_PI / 180.0f), MIC_RADIUS * sinf(180.0f * M_PI / 180.0f)},// Mic 4 (180 deg)
+    {MIC_RADIUS * cosf(240.0f * M_PI / 180.0f), MIC_RADIUS * sinf(240.0f * M_PI / 180.0f)},// Mic 5 (240 deg)
+    {MIC_RADIUS * cosf(300.0f * M_PI / 180.0f), MIC_RADIUS * sinf(300.0f * M_PI / 180.0f)},// Mic 6 (300 deg)
+    {0.0f, 0.0f}, //Mic 7 (spare)
+};
@@ -0,0 +1,93 @@
+#include "vad.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+bool parse_vad_mode(const std::string& text, VadMode& mode) {
+    if (text == "fixed") {
+        mode = VadMode::Fixed;
+    } else if (text == "adaptive") {
+        mode = VadMode::Adaptive;
+    } else if (text == "flux") {
+        mode = VadMode::Flux;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* vad_mode_name(VadMode mode) {
+    switch (mode) {
+        case VadMode::Fixed: return "fixed";
+        case VadMode::Adaptive: return "adaptive";
+        case VadMode::Flux: return "flux";
+    }
+    return "?";
+}
+
+VoiceActivityDetector::VoiceActivityDetector(VadMode mode, const DoaConfig& config) : mode_(mode) {
+    const double hop_s = (double)config.hop_size / config.sample_rate;
+    floor_rise_ = (float)std::pow(10.0, FLOOR_RISE_DB_PER_S * hop_s / 10.0);
+    hangover_hops_ = std::max(1, (int)std::lround(HANGOVER_S / hop_s));
+
+    const int min_bin = static_cast<int>(MIN_FREQ * config.fft_size / config.sample_rate);
+    const int max_bin = static_cast<int>(MAX_FREQ * config.fft_size / config.sample_rate);
+    for (int b = 0; b <= FLUX_BANDS; ++b) {
+        band_edges_[b] = min_bin + (max_bin + 1 - min_bin) * b / FLUX_BANDS;
+    }
+    std::fill(band_average_db_, band_average_db_ + FLUX_BANDS, 0.0f);
+}
+
+bool VoiceActivityDetector::update_energy(float mean_square) {
+    if (mode_ == VadMode::Fixed) return true;
+
+    // Running minimum that creeps up slowly, so it settles on the noise between words
+    if (!have_floor_) {
+        floor_ = std::max(mean_square, MIN_FLOOR);
+        have_floor_ = true;
+    } else if (mean_square < floor_) {
+        floor_ = std::max(mean_square, MIN_FLOOR);
+    } else {
+        floor_ = std::min(mean_square, floor_ * floor_rise_);
+    }
+
+    if (mean_square > floor_ * VAD_ON_RATIO) {
+        energy_hangover_ = hangover_hops_;
+        return true;
+    }
+    if (energy_hangover_ > 0) {
+        --energy_hangover_;
+        return true;
+    }
+    return false;
+}
+
+bool VoiceActivityDetector::confirm_spectrum(const ComplexVector& centre_fft) {
+    if (mode_ != VadMode::Flux) return true;
+
+    float flux_db = 0.0f;
+    for (int b = 0; b < FLUX_BANDS; ++b) {
+        double energy = 1e-20;
+        for (int k = band_edges_[b]; k < band_edges_[b + 1]; ++k) energy += std::norm(centre_fft[k]);
+        const float level_db = (float)(10.0 * std::log10(energy));
+        if (have_band_average_) {
+            flux_db += std::max(0.0f, level_db - band_average_db_[b]);
+            band_average_db_[b] += FLUX_SMOOTHING * (level_db - band_average_db_[b]);
+        } else {
+            band_average_db_[b] = level_db;
+        }
+    }
+    // The first spectrum has nothing to compare against; treat it as an onset
+    last_flux_db_ = have_band_average_ ? flux_db / FLUX_BANDS : FLUX_THRESHOLD_DB;
+    have_band_average_ = true;
+
+    if (last_flux_db_ >= FLUX_THRESHOLD_DB) {
+        flux_hangover_ = hangover_hops_;
+        return true;
+    }
+    if (flux_hangover_ > 0) {
+        --flux_hangover_;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,75 @@
+// =================================================================================================
+// Adaptive voice-activity detector for the DOA pipeline
+// =================================================================================================
+//
+// Decides per hop whether there is anything worth localizing, so silent hops can skip the
+// windowing, FFTs and beamformer altogether.
+//
+// Stage 1 runs before any framing work, on the mean square of the centre mic over the hop's new
+// samples (accumulated by the capture side as raw blocks arrive). It tracks the noise floor as a
+// running minimum that may rise by at most FLOOR_RISE_DB_PER_S, and calls a hop active when it
+// is VAD_ON_RATIO above the floor. A short hangover keeps speech tails and gaps between syllables.
+//
+// Stage 2 (VadMode::Flux only) runs on hops that passed stage 1, once their FFTs exist. It splits
+// the voice band of the centre mic into FLUX_BANDS bands and measures the mean rise, in dB, of
+// each band above its recent average (spectral flux). Stationary noise that lifts the energy (a
+// fan starting, a motor under load) barely changes the spectrum, so those hops skip the
+// beamformer until the noise floor has caught up.
+//
+// VadMode::Fixed keeps the original behaviour: every hop is framed and the windowed centre mic is
+// compared against ENERGY_THRESHOLD.
+//
+// Not thread-safe: one detector per processing thread.
+// =================================================================================================
+
+#pragma once
+
+#include "doa_engine.hpp"
+
+#include <string>
+#include <vector>
+
+enum class VadMode { Fixed, Adaptive, Flux };
+
+bool parse_vad_mode(const std::string& text, VadMode& mode);
+const char* vad_mode_name(VadMode mode);
+
+class VoiceActivityDetector {
+public:
+    static constexpr float VAD_ON_RATIO = 4.0f;          // Hop energy over the floor (6 dB) to count as active
+    static constexpr float FLOOR_RISE_DB_PER_S = 3.0f;   // How fast the floor follows rising noise
+    static constexpr float MIN_FLOOR = 1e-10f;           // Mean-square floor never drops below -100 dBFS
+    static constexpr float HANGOVER_S = 0.10f;           // Activity held after the last active hop
+    static const int FLUX_BANDS = 8;
+    static constexpr float FLUX_THRESHOLD_DB = 1.5f;     // Mean band rise above the recent average
+    static constexpr float FLUX_SMOOTHING = 0.25f;       // Weight of the newest hop in the band average
+
+    VoiceActivityDetector(VadMode mode, const DoaConfig& config);
+
+    VadMode mode() const { return mode_; }
+
+    // Stage 1: feeds the mean square of the centre mic over the newest hop. Returns false if the
+    // hop is silent and needs no further work. Always true in Fixed mode.
+    bool update_energy(float mean_square);
+
+    // Stage 2: for hops that passed stage 1, checks the centre mic spectrum (fft_size bins) for
+    // change. Returns whether the hop is active. Always true outside Flux mode.
+    bool confirm_spectrum(const ComplexVector& centre_fft);
+
+    float noise_floor() const { return floor_; } // Mean square
+    float last_flux_db() const { return last_flux_db_; }
+
+private:
+    VadMode mode_;
+    float floor_rise_;              // Per-hop multiplier on the floor while noise is rising
+    int hangover_hops_;
+    int energy_hangover_ = 0;
+    int flux_hangover_ = 0;
+    float floor_ = 0.0f;
+    bool have_floor_ = false;
+
+    int band_edges_[FLUX_BANDS + 1]; // FFT bins splitting the voice band
+    float band_average_db_[FLUX_BANDS];
+    bool have_band_average_ = false;
+    float last_flux_db_ = 0.0f;
+};